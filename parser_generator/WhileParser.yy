@@ -35,14 +35,16 @@ namespace parser {
 }
 }
 
-// The parsing context.
-%param { parser::WhileParsingContext &context }
+// The parsing context, and the state of the reentrant scanner. The context is
+// not called "context", since bison 3.6+ declares a class of that name
+// inside the parser.
+%param { parser::WhileParsingContext &parsingContext } { void* scanner }
 %locations
 %define api.location.type {Location}
 %initial-action
 {
   // Initialize the initial location.
-  @$.begin.filename = @$.end.filename = &context.inputFile;
+  @$.begin.filename = @$.end.filename = &parsingContext.inputFile;
 };
 %define parse.trace
 %define parse.error verbose
@@ -53,7 +55,7 @@ namespace parser {
 using namespace program;
 
 // Tell Flex the lexer's prototype ...
-# define YY_DECL parser::WhileParser::symbol_type yylex(parser::WhileParsingContext &context)
+# define YY_DECL parser::WhileParser::symbol_type yylex(parser::WhileParsingContext &context, void* yyscanner)
 // ... and declare it for the parser's sake.
 YY_DECL;
 
@@ -156,30 +158,30 @@ problem:
   }
   program smtlib_problemitem_list
   {
-    context.problemItems = $3;
+    parsingContext.problemItems = $3;
   }
 |
   LPAR SETTRACES INTEGER RPAR
   {
     if ($3 < 1)
     {
-      error(@3, "number of traces has to be greater than or equal to 1");
+      throw syntax_error(@3, "number of traces has to be greater than or equal to 1");
     }
 
-    context.numberOfTraces = (unsigned) $3;
+    parsingContext.numberOfTraces = (unsigned) $3;
     logic::Theory::declareTheories();
-    declareSymbolsForTraces(context.numberOfTraces);
+    declareSymbolsForTraces(parsingContext.numberOfTraces);
   }
   program smtlib_problemitem_list
   {
-        context.problemItems = $7;
+        parsingContext.problemItems = $7;
   }
 ;
 
 program:
   function_list
   {
-    context.program = std::unique_ptr<const program::Program>(new program::Program($1));
+    parsingContext.program = std::unique_ptr<const program::Program>(new program::Program($1));
   }
 ;
 
@@ -191,20 +193,20 @@ smtlib_problemitem_list:
 smtlib_problemitem:
   LPAR AXIOM smtlib_formula RPAR
   {
-    $$ = std::shared_ptr<const logic::Axiom>(new logic::Axiom($3, "user-axiom-" + std::to_string(context.numberOfAxioms)));
-    context.numberOfAxioms++;
+    $$ = std::shared_ptr<const logic::Axiom>(new logic::Axiom($3, "user-axiom-" + std::to_string(parsingContext.numberOfAxioms)));
+    parsingContext.numberOfAxioms++;
   }
 |
   LPAR LEMMA smtlib_formula RPAR
   {
-    $$ = std::shared_ptr<const logic::Lemma>(new logic::Lemma($3, "user-lemma-" + std::to_string(context.numberOfLemmas)));
-    context.numberOfLemmas++;
+    $$ = std::shared_ptr<const logic::Lemma>(new logic::Lemma($3, "user-lemma-" + std::to_string(parsingContext.numberOfLemmas)));
+    parsingContext.numberOfLemmas++;
   }
 |
   LPAR CONJECTURE smtlib_formula RPAR
   {
-    $$ = std::shared_ptr<const logic::Conjecture>(new logic::Conjecture($3, "user-conjecture-" + std::to_string(context.numberOfConjectures)));
-    context.numberOfConjectures++;
+    $$ = std::shared_ptr<const logic::Conjecture>(new logic::Conjecture($3, "user-conjecture-" + std::to_string(parsingContext.numberOfConjectures)));
+    parsingContext.numberOfConjectures++;
   }
 
 smtlib_formula_list:
@@ -222,7 +224,7 @@ smtlib_formula:
 
     if(leftSort != rightSort)
     {
-      error(@4, "Argument types " + leftSort->name + " and " + rightSort->name + " don't match!");
+      throw syntax_error(@4, "Argument types " + leftSort->name + " and " + rightSort->name + " don't match!");
     }
     $$ = logic::Formulas::equality(std::move($3), std::move($4));
   }
@@ -230,11 +232,11 @@ smtlib_formula:
 {
   if($3->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@3, "Left argument type needs to be Int");
+    throw syntax_error(@3, "Left argument type needs to be Int");
   }
   if($4->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@4, "Right argument type needs to be Int");
+    throw syntax_error(@4, "Right argument type needs to be Int");
   }
   $$ = logic::Theory::intGreater(std::move($3), std::move($4));
 }
@@ -242,11 +244,11 @@ smtlib_formula:
 {
   if($3->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@3, "Left argument type needs to be Int");
+    throw syntax_error(@3, "Left argument type needs to be Int");
   }
   if($4->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@4, "Right argument type needs to be Int");
+    throw syntax_error(@4, "Right argument type needs to be Int");
   }
   $$ = logic::Theory::intGreaterEqual(std::move($3), std::move($4));
 }
@@ -254,11 +256,11 @@ smtlib_formula:
 {
   if($3->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@3, "Left argument type needs to be Int");
+    throw syntax_error(@3, "Left argument type needs to be Int");
   }
   if($4->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@4, "Right argument type needs to be Int");
+    throw syntax_error(@4, "Right argument type needs to be Int");
   }
   $$ = logic::Theory::intLess(std::move($3), std::move($4));
 }
@@ -266,11 +268,11 @@ smtlib_formula:
 {
   if($3->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@3, "Left argument type needs to be Int");
+    throw syntax_error(@3, "Left argument type needs to be Int");
   }
   if($4->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@4, "Right argument type needs to be Int");
+    throw syntax_error(@4, "Right argument type needs to be Int");
   }
   $$ = logic::Theory::intLessEqual(std::move($3), std::move($4));
 }
@@ -281,21 +283,21 @@ smtlib_formula:
 | LPAR FORALLSMTLIB LPAR smtlib_quantvar_list RPAR
   {
     // TODO: propagate existing-var-error to parser and raise error
-    context.pushQuantifiedVars($4);
+    parsingContext.pushQuantifiedVars($4);
   }
   smtlib_formula RPAR
   {
-    context.popQuantifiedVars();
+    parsingContext.popQuantifiedVars();
     $$ = logic::Formulas::universal(std::move($4), std::move($7));
   }
 | LPAR EXISTSSMTLIB LPAR smtlib_quantvar_list RPAR
   {
     // TODO: propagate existing-var-error to parser and raise error
-    context.pushQuantifiedVars($4);
+    parsingContext.pushQuantifiedVars($4);
   }
   smtlib_formula RPAR
   {
-    context.popQuantifiedVars();
+    parsingContext.popQuantifiedVars();
     $$ = logic::Formulas::existential(std::move($4), std::move($7));
   }
 ;
@@ -308,9 +310,9 @@ smtlib_quantvar_list:
 smtlib_quantvar:
   LPAR SMTLIB_ID TYPE RPAR
   {
-    if(context.isDeclared($2))
+    if(parsingContext.isDeclared($2))
     {
-      error(@2, $2 + " has already been declared");
+      throw syntax_error(@2, $2 + " has already been declared");
     }
     if($3 == "Int")
     {
@@ -332,7 +334,7 @@ smtlib_quantvar:
     {
       if($3 != "Trace")
       {
-        error(@3, "Only the sorts Int, Bool, Time and Trace are supported");
+        throw syntax_error(@3, "Only the sorts Int, Bool, Time and Trace are supported");
       }
       $$ = logic::Signature::varSymbol($2, logic::Sorts::traceSort());
     }
@@ -347,15 +349,15 @@ smtlib_term_list:
 smtlib_term:
 SMTLIB_ID
 {
-  if(!context.isDeclared($1))
+  if(!parsingContext.isDeclared($1))
   {
-    error(@1, $1 + " has not been declared");
+    throw syntax_error(@1, $1 + " has not been declared");
   }
-  auto symbol = context.fetch($1);
+  auto symbol = parsingContext.fetch($1);
 
   if(symbol->argSorts.size() > 0)
   {
-      error(@1, "Not enough arguments for term " + symbol->name);
+      throw syntax_error(@1, "Not enough arguments for term " + symbol->name);
   }
   $$ = logic::Terms::func(symbol, std::vector<std::shared_ptr<const logic::Term>>());
 }
@@ -365,25 +367,25 @@ SMTLIB_ID
   }
 | LPAR SMTLIB_ID smtlib_term_list RPAR
 {
-  if(!context.isDeclared($2))
+  if(!parsingContext.isDeclared($2))
   {
-    error(@2, $2 + " has not been declared");
+    throw syntax_error(@2, $2 + " has not been declared");
   }
-  auto symbol = context.fetch($2);
+  auto symbol = parsingContext.fetch($2);
 
   if($3.size() < symbol->argSorts.size())
   {
-      error(@3, "Not enough arguments for term " + symbol->name);
+      throw syntax_error(@3, "Not enough arguments for term " + symbol->name);
   }
   if($3.size() > symbol->argSorts.size())
   {
-      error(@3, "Too many arguments for term " + symbol->name);
+      throw syntax_error(@3, "Too many arguments for term " + symbol->name);
   }
   for (int i=0; i < symbol->argSorts.size(); ++i)
   {
       if(symbol->argSorts[i] != $3[i]->symbol->rngSort)
       {
-        error(@3, "Argument has type " + $3[i]->symbol->rngSort->name + " instead of " + symbol->argSorts[i]->name);
+        throw syntax_error(@3, "Argument has type " + $3[i]->symbol->rngSort->name + " instead of " + symbol->argSorts[i]->name);
       }
   }
   $$ = logic::Terms::func(symbol, std::move($3));
@@ -392,11 +394,11 @@ SMTLIB_ID
 {
   if($3->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@3, "Left argument type needs to be Int");
+    throw syntax_error(@3, "Left argument type needs to be Int");
   }
   if($4->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@4, "Right argument type needs to be Int");
+    throw syntax_error(@4, "Right argument type needs to be Int");
   }
   $$ = logic::Theory::intAddition(std::move($3), std::move($4));
 }
@@ -404,11 +406,11 @@ SMTLIB_ID
 {
   if($3->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@3, "Left argument type needs to be Int");
+    throw syntax_error(@3, "Left argument type needs to be Int");
   }
   if($4->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@4, "Right argument type needs to be Int");
+    throw syntax_error(@4, "Right argument type needs to be Int");
   }
   $$ = logic::Theory::intSubtraction(std::move($3), std::move($4));
 }
@@ -416,11 +418,11 @@ SMTLIB_ID
 {
   if($3->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@3, "Left argument type needs to be Int");
+    throw syntax_error(@3, "Left argument type needs to be Int");
   }
   if($4->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@4, "Right argument type needs to be Int");
+    throw syntax_error(@4, "Right argument type needs to be Int");
   }
   $$ = logic::Theory::intModulo(std::move($3), std::move($4));
 }
@@ -428,11 +430,11 @@ SMTLIB_ID
 {
   if($3->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@3, "Left argument type needs to be Int");
+    throw syntax_error(@3, "Left argument type needs to be Int");
   }
   if($4->symbol->rngSort != logic::Sorts::intSort())
   {
-    error(@4, "Right argument type needs to be Int");
+    throw syntax_error(@4, "Right argument type needs to be Int");
   }
   $$ = logic::Theory::intMultiplication(std::move($3), std::move($4));
 }
@@ -446,22 +448,22 @@ function_list:
 function:
   FUNC PROGRAM_ID LPAR RPAR LCUR
   {
-    context.pushProgramVars();
+    parsingContext.pushProgramVars();
   }
   statement_list RCUR
   {
     auto functionEndLocationName = $2 + "_end";
-    context.locationToActiveVars[functionEndLocationName] = context.getActiveProgramVars();
-    context.popProgramVars();
+    parsingContext.locationToActiveVars[functionEndLocationName] = parsingContext.getActiveProgramVars();
+    parsingContext.popProgramVars();
 
   	auto function = std::shared_ptr<const program::Function>(new program::Function($2, std::move($7)));
 
     // compute enclosing loops
-    context.addEnclosingLoops(*function);
+    parsingContext.addEnclosingLoops(*function);
     $$ = function;
 
     // declare symbols for loops (needs to be done here, since it depends on enclosingLoops)
-    declareSymbolsForFunction(function.get(), context.numberOfTraces);
+    declareSymbolsForFunction(function.get(), parsingContext.numberOfTraces);
   }
 ;
 
@@ -470,13 +472,13 @@ statement_list:
 | statement_list active_vars_dummy statement
   {
     auto locationName = $3->location;
-    context.locationToActiveVars[locationName] = $2;
+    parsingContext.locationToActiveVars[locationName] = $2;
     $1.push_back(std::move($3)); $$ = std::move($1);
   }
 | statement_list active_vars_dummy var_definition_head SCOL
   {
     // dummy is not used here, but silences a shift-reduce conflict
-    context.addProgramVar($3);
+    parsingContext.addProgramVar($3);
     declareSymbolForProgramVar($3.get());
     $$ = std::move($1);
   }
@@ -497,7 +499,7 @@ assignment_statement:
       auto intVariableAccess = std::static_pointer_cast<const program::IntVariableAccess>($1);
       if(intVariableAccess->var->isConstant)
       {
-        error(@1, "Assignment to const var " + intVariableAccess->var->name);
+        throw syntax_error(@1, "Assignment to const var " + intVariableAccess->var->name);
       }
     }
     else
@@ -506,7 +508,7 @@ assignment_statement:
       auto intArrayApplication = std::static_pointer_cast<const program::IntArrayApplication>($1);
       if(intArrayApplication->array->isConstant)
       {
-        error(@1, "Assignment to const var " + intArrayApplication->array->name);
+        throw syntax_error(@1, "Assignment to const var " + intArrayApplication->array->name);
       }
     }
     $$ = std::shared_ptr<const program::IntAssignment>(new program::IntAssignment(@2.begin.line, std::move($1), std::move($3)));
@@ -514,13 +516,13 @@ assignment_statement:
 | var_definition_head ASSIGN expr SCOL
   {
     // declare var
-    context.addProgramVar($1);
+    parsingContext.addProgramVar($1);
     declareSymbolForProgramVar($1.get());
 
     // construct location
     if($1->isArray)
     {
-      error(@1, "Combined declaration and assignment not allowed, since " + $1->name + " is array variable");
+      throw syntax_error(@1, "Combined declaration and assignment not allowed, since " + $1->name + " is array variable");
     }
     auto intVariableAccess = std::shared_ptr<const program::IntVariableAccess>(new IntVariableAccess(std::move($1)));
 
@@ -532,24 +534,24 @@ assignment_statement:
 if_else_statement:
   IF LPAR formula RPAR
   {
-    context.pushProgramVars();
+    parsingContext.pushProgramVars();
   }
   LCUR statement_list active_vars_dummy RCUR
   {
-    context.popProgramVars();
+    parsingContext.popProgramVars();
   }
   ELSE
   {
-    context.pushProgramVars();
+    parsingContext.pushProgramVars();
   }
   LCUR statement_list active_vars_dummy RCUR
   {
-    context.popProgramVars();
+    parsingContext.popProgramVars();
 
     auto leftEndLocationName = "l" + std::to_string(@1.begin.line) + "_lEnd";
     auto rightEndLocationName = "l" + std::to_string(@1.begin.line) + "_rEnd";
-    context.locationToActiveVars[leftEndLocationName] = $8;
-    context.locationToActiveVars[rightEndLocationName] = $15;
+    parsingContext.locationToActiveVars[leftEndLocationName] = $8;
+    parsingContext.locationToActiveVars[rightEndLocationName] = $15;
     $$ = std::shared_ptr<const program::IfElse>(new program::IfElse(@1.begin.line, std::move($3), std::move($7), std::move($14)));
   }
 ;
@@ -557,11 +559,11 @@ if_else_statement:
 while_statement:
   WHILE formula
   {
-    context.pushProgramVars();
+    parsingContext.pushProgramVars();
   }
   LCUR statement_list RCUR
   {
-    context.popProgramVars();
+    parsingContext.popProgramVars();
     $$ = std::shared_ptr<const program::WhileStatement>(new program::WhileStatement(@1.begin.line, std::move($2), std::move($5)));
   }
 ;
@@ -573,7 +575,7 @@ skip_statement:
 active_vars_dummy:
   %empty
   {
-    $$ = context.getActiveProgramVars();
+    $$ = parsingContext.getActiveProgramVars();
   }
 ;
 
@@ -582,49 +584,49 @@ var_definition_head:
   {
     if($1 == "Bool")
     {
-      error(@1, "Program variables of type Bool are not supported");
+      throw syntax_error(@1, "Program variables of type Bool are not supported");
     }
     if($1 == "Nat" || $1 == "Time" || $1 == "Trace")
     {
-      error(@1, "Program variables can't have type " + $1);
+      throw syntax_error(@1, "Program variables can't have type " + $1);
     }
-    $$ = std::shared_ptr<const program::Variable>(new program::Variable($2, false, false, context.numberOfTraces));
+    $$ = std::shared_ptr<const program::Variable>(new program::Variable($2, false, false, parsingContext.numberOfTraces));
   }
 | CONST TYPE PROGRAM_ID
   {
     if($2 == "Bool")
     {
-      error(@1, "Program variables of type Bool are not supported");
+      throw syntax_error(@1, "Program variables of type Bool are not supported");
     }
     if($2 == "Nat" || $2 == "Time" || $2 == "Trace")
     {
-      error(@2, "Program variables can't have type " + $2);
+      throw syntax_error(@2, "Program variables can't have type " + $2);
     }
-    $$ = std::shared_ptr<const program::Variable>(new program::Variable($3, true, false, context.numberOfTraces));
+    $$ = std::shared_ptr<const program::Variable>(new program::Variable($3, true, false, parsingContext.numberOfTraces));
   }
 | TYPE LBRA RBRA PROGRAM_ID
   {
     if($1 == "Bool")
     {
-      error(@1, "Program variables of type Bool are not supported");
+      throw syntax_error(@1, "Program variables of type Bool are not supported");
     }
     if($1 == "Nat" || $1 == "Time" || $1 == "Trace")
     {
-      error(@1, "Program variables can't have type " + $1);
+      throw syntax_error(@1, "Program variables can't have type " + $1);
     }
-    $$ = std::shared_ptr<const program::Variable>(new program::Variable($4, false, true, context.numberOfTraces));
+    $$ = std::shared_ptr<const program::Variable>(new program::Variable($4, false, true, parsingContext.numberOfTraces));
   }
 | CONST TYPE LBRA RBRA PROGRAM_ID
   {
     if($2 == "Bool")
     {
-      error(@1, "Program variables of type Bool are not supported");
+      throw syntax_error(@1, "Program variables of type Bool are not supported");
     }
     if($2 == "Nat" || $2 == "Time" || $2 == "Trace")
     {
-      error(@2, "Program variables can't have type " + $2);
+      throw syntax_error(@2, "Program variables can't have type " + $2);
     }
-    $$ = std::shared_ptr<const program::Variable>(new program::Variable($5, true, true, context.numberOfTraces));
+    $$ = std::shared_ptr<const program::Variable>(new program::Variable($5, true, true, parsingContext.numberOfTraces));
   }
 ;
 
@@ -657,29 +659,39 @@ expr:
 location:
   PROGRAM_ID
   {
-  	auto var = context.getProgramVar($1);
+  	auto var = parsingContext.getProgramVar($1);
+    if(!var)
+    {
+      throw syntax_error(@1, "Program variable " + $1 + " has not been declared");
+    }
     if(var->isArray)
     {
-      error(@1, "Array variable " + var->name + " needs index for access");
+      throw syntax_error(@1, "Array variable " + var->name + " needs index for access");
     }
     $$ = std::shared_ptr<const program::IntVariableAccess>(new IntVariableAccess(std::move(var)));
   }
 | PROGRAM_ID LBRA expr RBRA
   {
-	  auto var = context.getProgramVar($1);
+	  auto var = parsingContext.getProgramVar($1);
+    if(!var)
+    {
+      throw syntax_error(@1, "Program variable " + $1 + " has not been declared");
+    }
     if(!var->isArray)
     {
-      error(@1, "Variable " + var->name + " is not an array");
+      throw syntax_error(@1, "Variable " + var->name + " is not an array");
     }
 	  $$ = std::shared_ptr<const program::IntArrayApplication>(new IntArrayApplication(std::move(var), std::move($3)));
   }
 ;
 
 %%
+// reports a syntax error. Errors detected in the actions of the parser and the
+// scanner are thrown as syntax_error, so that the parser stops and reports
+// them here.
 void parser::WhileParser::error(const location_type& l,
                               const std::string& m)
 {
   std::cout << "Error while parsing location " << l << ":\n" << m << std::endl;
-  context.errorFlag = true;
-  exit(1);
+  parsingContext.errorFlag = true;
 }
@@ -15,18 +15,15 @@
 # undef yywrap
 # define yywrap() 1
 
-// The location of the current token.
-static parser::Location loc;
-
+// the parser reports the error and stops
 void error(const parser::Location& l,
            const std::string& m)
 {
-    std::cout << l << m << std::endl;
-    exit(1);
+    throw parser::WhileParser::syntax_error(l, m);
 }
 
 %}
-%option noyywrap nounput batch debug noinput
+%option reentrant noyywrap nounput batch debug noinput
 IDENT [a-z][a-zA-Z_0-9]*
 NUM   [0-9]+
 BLANK [ \t]
@@ -35,7 +32,7 @@ BLANK [ \t]
 #include "WhileParsingContext.hpp"
 using namespace program;
 // Tell Flex the lexer's prototype ...
-# define YY_DECL parser::WhileParser::symbol_type yylex(parser::WhileParsingContext &context)
+# define YY_DECL parser::WhileParser::symbol_type yylex(parser::WhileParsingContext &context, void* yyscanner)
 // ... and declare it for the parser's sake.
 YY_DECL;
 %}
@@ -51,6 +48,8 @@ YY_DECL;
 
 %{
   // Code run each time yylex is called.
+  // The location of the current token.
+  parser::Location& loc = context.location;
   loc.step();
 %}
 
@@ -2,159 +2,83 @@
 
 #include <cassert>
 
+#include "FormulaVisitor.hpp"
 #include "SemanticsHelper.hpp"
 #include "SymbolDeclarations.hpp"
 #include "Term.hpp"
 #include "Theory.hpp"
 
 namespace analysis {
-void SemanticsInliner::computePersistentTerms(
-    std::vector<std::shared_ptr<const logic::ProblemItem>>& problemItems) {
-  for (auto item : problemItems) {
-    computePersistentTermsRec(item->formula);
-  }
-}
-
-void SemanticsInliner::computePersistentTermsRec(
-    std::shared_ptr<const logic::Formula> f) {
-  switch (f->type()) {
-    case logic::Formula::Type::Predicate: {
-      auto castedFormula =
-          std::static_pointer_cast<const logic::PredicateFormula>(f);
-      for (const auto& subterm : castedFormula->subterms) {
-        computePersistentTermsRec(subterm);
-      }
-      break;
-    }
-    case logic::Formula::Type::Equality: {
-      auto castedFormula =
-          std::static_pointer_cast<const logic::EqualityFormula>(f);
-      computePersistentTermsRec(castedFormula->left);
-      computePersistentTermsRec(castedFormula->right);
-      break;
-    }
-    case logic::Formula::Type::Conjunction: {
-      auto castedFormula =
-          std::static_pointer_cast<const logic::ConjunctionFormula>(f);
-      for (const auto& subterm : castedFormula->conj) {
-        computePersistentTermsRec(subterm);
-      }
-      break;
-    }
-    case logic::Formula::Type::Disjunction: {
-      auto castedFormula =
-          std::static_pointer_cast<const logic::DisjunctionFormula>(f);
-      for (const auto& subterm : castedFormula->disj) {
-        computePersistentTermsRec(subterm);
-      }
-      break;
-    }
-    case logic::Formula::Type::Negation: {
-      auto castedFormula =
-          std::static_pointer_cast<const logic::NegationFormula>(f);
-      computePersistentTermsRec(castedFormula->f);
-      break;
-    }
-    case logic::Formula::Type::Existential: {
-      auto castedFormula =
-          std::static_pointer_cast<const logic::ExistentialFormula>(f);
-      computePersistentTermsRec(castedFormula->f);
-      break;
-    }
-    case logic::Formula::Type::Universal: {
-      auto castedFormula =
-          std::static_pointer_cast<const logic::UniversalFormula>(f);
-      computePersistentTermsRec(castedFormula->f);
-      break;
-    }
-    case logic::Formula::Type::Implication: {
-      auto castedFormula =
-          std::static_pointer_cast<const logic::ImplicationFormula>(f);
-      computePersistentTermsRec(castedFormula->f1);
-      computePersistentTermsRec(castedFormula->f2);
-      break;
-    }
-    case logic::Formula::Type::Equivalence: {
-      auto castedFormula =
-          std::static_pointer_cast<const logic::EquivalenceFormula>(f);
-      computePersistentTermsRec(castedFormula->f1);
-      computePersistentTermsRec(castedFormula->f2);
-      break;
-    }
-    case logic::Formula::Type::True: {
-      break;
-    }
-    case logic::Formula::Type::False: {
-      break;
-    }
-    default: {
-      assert(false);
-      break;
-    }
-  }
-}
-
-void SemanticsInliner::computePersistentTermsRec(
-    std::shared_ptr<const logic::Term> t) {
-  switch (t->type()) {
-    case logic::Term::Type::Variable: {
-      // do nothing
-      break;
-    }
-    case logic::Term::Type::FuncTerm: {
-      auto castedTerm = std::static_pointer_cast<const logic::FuncTerm>(t);
-
-      // handle term: search for a term of sort Int, which has a subterm of sort
-      // Location
-      // TODO: could make this check more precise, so that it always only
-      // detects terms v(l(...)), where v is a variable occuring in the program
-      // and l is a location of the program
-      if (castedTerm->symbol->rngSort == logic::Sorts::intSort()) {
-        // check whether castedTerm could denote mutable program variable
-        if (castedTerm->subterms.size() >= 1 &&
-            castedTerm->subterms[0]->symbol->rngSort ==
-                logic::Sorts::timeSort()) {
-          auto programVarName = castedTerm->symbol->name;
-          auto timepointName = castedTerm->subterms[0]->symbol->name;
-
-          if (persistentVarTerms.find(programVarName) ==
-              persistentVarTerms.end()) {
-            persistentVarTerms[programVarName] = {timepointName};
-          } else {
-            persistentVarTerms[programVarName].push_back(timepointName);
-          }
-        } else {
-          // check whether castedTerm could denote constant program variable
-          // TODO: could make this check more precise, currently just ensure
-          // that no subterm is of sort time.
-          bool noTimepointSubterms = true;
-          for (const auto& subterm : castedTerm->subterms) {
-            if (subterm->symbol->rngSort == logic::Sorts::timeSort()) {
-              noTimepointSubterms = false;
-              break;
-            }
+namespace {
+
+// collects the program variables referenced in the input formulas (see
+// persistentVarTerms and persistentConstVarTerms)
+class PersistentTermsCollector : public logic::FormulaVisitor {
+ public:
+  PersistentTermsCollector(
+      std::unordered_map<std::string, std::unordered_set<std::string>>&
+          persistentVarTerms,
+      std::unordered_set<std::string>& persistentConstVarTerms)
+      : persistentVarTerms(persistentVarTerms),
+        persistentConstVarTerms(persistentConstVarTerms) {}
+
+ protected:
+  void postVisit(const logic::Term& t) override {
+    if (t.type() != logic::Term::Type::FuncTerm) {
+      return;
+    }
+    auto& funcTerm = static_cast<const logic::FuncTerm&>(t);
+
+    // handle term: search for a term of sort Int, which has a subterm of sort
+    // Location
+    // TODO: could make this check more precise, so that it always only
+    // detects terms v(l(...)), where v is a variable occuring in the program
+    // and l is a location of the program
+    if (funcTerm.symbol->rngSort == logic::Sorts::intSort()) {
+      // check whether funcTerm could denote mutable program variable
+      if (funcTerm.subterms.size() >= 1 &&
+          funcTerm.subterms[0]->symbol->rngSort == logic::Sorts::timeSort()) {
+        auto programVarName = funcTerm.symbol->name;
+        auto timepointName = funcTerm.subterms[0]->symbol->name;
+
+        persistentVarTerms[programVarName].insert(timepointName);
+      } else {
+        // check whether funcTerm could denote constant program variable
+        // TODO: could make this check more precise, currently just ensure
+        // that no subterm is of sort time.
+        bool noTimepointSubterms = true;
+        for (const auto& subterm : funcTerm.subterms) {
+          if (subterm->symbol->rngSort == logic::Sorts::timeSort()) {
+            noTimepointSubterms = false;
+            break;
           }
-          if (noTimepointSubterms) {
-            auto programVarName = castedTerm->symbol->name;
-            if (programVarName != "0" && programVarName != "1" &&
-                programVarName != "-") {
-              persistentConstVarTerms.insert(programVarName);
-            }
+        }
+        if (noTimepointSubterms) {
+          auto programVarName = funcTerm.symbol->name;
+          if (programVarName != "0" && programVarName != "1" &&
+              programVarName != "-") {
+            persistentConstVarTerms.insert(programVarName);
           }
         }
       }
-
-      // recurse on subterms
-      for (const auto& subterm : castedTerm->subterms) {
-        computePersistentTermsRec(subterm);
-      }
-      break;
-    }
-    default: {
-      assert(false);
-      break;
     }
   }
+
+ private:
+  std::unordered_map<std::string, std::unordered_set<std::string>>&
+      persistentVarTerms;
+  std::unordered_set<std::string>& persistentConstVarTerms;
+};
+
+}  // namespace
+
+void SemanticsInliner::computePersistentTerms(
+    std::vector<std::shared_ptr<const logic::ProblemItem>>& problemItems) {
+  PersistentTermsCollector collector(persistentVarTerms,
+                                     persistentConstVarTerms);
+  for (auto item : problemItems) {
+    collector.visit(*item->formula);
+  }
 }
 
 std::shared_ptr<const logic::Term> SemanticsInliner::toCachedTermFull(
@@ -298,17 +222,11 @@ std::shared_ptr<const logic::Formula> SemanticsInliner::handlePersistence(
   for (const auto& var : activeVars) {
     if (!var->isConstant) {
       // check whether value of variable term should be defined
-      bool varTermShouldBeDefined = false;
-      if (persistentVarTerms.find(var->name) != persistentVarTerms.end()) {
-        for (const auto& locationName : persistentVarTerms[var->name]) {
-          if (locationName == timepoint->symbol->name) {
-            // we have now established that var(timepoint,...) is referenced, so
-            // we need to define it
-            varTermShouldBeDefined = true;
-            break;
-          }
-        }
-      }
+      // (if var(timepoint,...) is referenced, we need to define it)
+      auto it = persistentVarTerms.find(var->name);
+      bool varTermShouldBeDefined =
+          it != persistentVarTerms.end() &&
+          it->second.count(timepoint->symbol->name) > 0;
 
       if (varTermShouldBeDefined) {
         if (!var->isArray) {
@@ -394,18 +312,12 @@ std::shared_ptr<const logic::Formula> SemanticsInliner::handlePersistenceOfLoop(
     assert(!var->isConstant);
 
     // check whether value of variable term should be defined
-    bool varTermShouldBeDefined = false;
-    if (persistentVarTerms.find(var->name) != persistentVarTerms.end()) {
-      for (const auto& locationName : persistentVarTerms[var->name]) {
-        if (locationName == startTimepoint->symbol->name) {
-          // we have now established that var(timepoint,...) is referenced
-          // (where timepoint is equal to startTimepoint up to the
-          // iteration-term), so we need to define it
-          varTermShouldBeDefined = true;
-          break;
-        }
-      }
-    }
+    // (if var(timepoint,...) is referenced, where timepoint is equal to
+    // startTimepoint up to the iteration-term, we need to define it)
+    auto it = persistentVarTerms.find(var->name);
+    bool varTermShouldBeDefined =
+        it != persistentVarTerms.end() &&
+        it->second.count(startTimepoint->symbol->name) > 0;
 
     if (varTermShouldBeDefined) {
       if (!var->isArray) {
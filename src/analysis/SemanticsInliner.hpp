@@ -96,13 +96,13 @@ class SemanticsInliner {
  private:
   std::shared_ptr<const logic::Term> trace;
 
-  typedef std::unordered_map<std::string, std::vector<std::string>>
+  typedef std::unordered_map<std::string, std::unordered_set<std::string>>
       MapVarNameToLocationName;
   typedef std::unordered_set<std::string> SetConstVarNames;
 
   /*
-   * a dictionary mapping the name of each non-const var to the name of the
-   * location where the var is referenced in some input conjecture (or in some
+   * a dictionary mapping the name of each non-const var to the names of the
+   * locations where the var is referenced in some input conjecture (or in some
    * input axiom/lemma) Note that we don't (need to) know the exact term (of the
    * conjecture/axiom/lemma) that occurs (we don't care about the exact
    * iteration or the position in the array) We keep track of these terms, since
@@ -119,8 +119,6 @@ class SemanticsInliner {
   SetConstVarNames persistentConstVarTerms;
   void computePersistentTerms(
       std::vector<std::shared_ptr<const logic::ProblemItem>>& problemItems);
-  void computePersistentTermsRec(std::shared_ptr<const logic::Formula> f);
-  void computePersistentTermsRec(std::shared_ptr<const logic::Term> t);
 
   typedef std::unordered_map<std::shared_ptr<const program::Variable>,
                              std::shared_ptr<const logic::Term>>
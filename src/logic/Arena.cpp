@@ -0,0 +1,56 @@
+#include "Arena.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <new>
+
+#include "Context.hpp"
+
+namespace logic {
+
+std::atomic<std::size_t> Arena::nextId(1);
+thread_local std::size_t Arena::currentArena = 0;
+thread_local char* Arena::current = nullptr;
+thread_local char* Arena::end = nullptr;
+
+Arena::Arena() : id(nextId++), mutex(), blocks() {}
+
+Arena::~Arena() {
+  for (auto block : blocks) {
+    ::operator delete(block);
+  }
+}
+
+char* Arena::newBlock(std::size_t size) {
+  auto block = ::operator new(size);
+  std::lock_guard<std::mutex> lock(mutex);
+  blocks.push_back(block);
+  return static_cast<char*>(block);
+}
+
+void* Arena::allocate(std::size_t size, std::size_t alignment) {
+  assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+  auto& arena = Context::current().arena;
+
+  // large nodes get a block of their own, so that the current block is not
+  // wasted
+  if (size + alignment > blockSize / 4) {
+    return arena.newBlock(size);
+  }
+
+  auto address = reinterpret_cast<std::uintptr_t>(current);
+  auto aligned = (address + alignment - 1) & ~(alignment - 1);
+  if (currentArena != arena.id ||
+      aligned + size > reinterpret_cast<std::uintptr_t>(end)) {
+    // the remainder of the current block is dropped
+    current = arena.newBlock(blockSize);
+    end = current + blockSize;
+    currentArena = arena.id;
+    address = reinterpret_cast<std::uintptr_t>(current);
+    aligned = (address + alignment - 1) & ~(alignment - 1);
+  }
+  current = reinterpret_cast<char*>(aligned + size);
+  return reinterpret_cast<void*>(aligned);
+}
+
+}  // namespace logic
@@ -0,0 +1,122 @@
+#ifndef __Arena__
+#define __Arena__
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace logic {
+
+#pragma mark - Arena
+
+// Bump-allocator for the nodes of the logic (symbols, terms and formulas).
+// Each Context owns an arena, which holds the nodes of that context. Logic
+// nodes are constructed once and are kept alive by the managing classes as
+// long as their context, so allocation is a pointer-increment, deallocation is
+// a no-op, and the blocks of the arena are released together with the context
+// (e.g. after each spec in batch mode).
+// The arena is only used if rapid is built with RAPID_ARENA (cmake option
+// RAPID_ARENA), otherwise all nodes are allocated individually on the heap.
+class Arena {
+ public:
+  Arena();
+  ~Arena();
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // allocates in the arena of the current context of the calling thread
+  static void* allocate(std::size_t size, std::size_t alignment);
+
+ private:
+  // size of the blocks requested from the heap. Larger allocations get a
+  // block of their own.
+  static const std::size_t blockSize = 1 << 20;
+
+  // requests a block of the given size from the heap, which is released with
+  // the arena
+  char* newBlock(std::size_t size);
+
+  // unique among all arenas, so that a thread notices when its current block
+  // belongs to an arena of another context (which may be released already)
+  const std::size_t id;
+  static std::atomic<std::size_t> nextId;
+
+  // the threads working in the same context allocate blocks concurrently
+  std::mutex mutex;
+  std::vector<void*> blocks;
+
+  // each thread allocates from its own current block
+  static thread_local std::size_t currentArena;  // id of the arena of the
+                                                 // current block
+  static thread_local char* current;  // next free byte in the current block
+  static thread_local char* end;      // end of the current block
+};
+
+// stateless allocator handing out memory of the arena, used for the
+// control-blocks of the shared pointers to logic nodes
+template <typename T>
+struct ArenaAllocator {
+  using value_type = T;
+
+  ArenaAllocator() = default;
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(Arena::allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T*, std::size_t) {}
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>&, const ArenaAllocator<U>&) {
+  return true;
+}
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>&, const ArenaAllocator<U>&) {
+  return false;
+}
+
+// base class for logic nodes, which are created using new inside the managing
+// classes (since their constructors are private). Routes these allocations to
+// the arena if RAPID_ARENA is set.
+class ArenaAllocated {
+#ifdef RAPID_ARENA
+ public:
+  static void* operator new(std::size_t size) {
+    return Arena::allocate(size, alignof(std::max_align_t));
+  }
+  static void operator delete(void*) {}
+#endif
+};
+
+// wraps a freshly created logic node into a shared pointer, whose control
+// block is allocated in the arena if RAPID_ARENA is set.
+template <typename T>
+std::shared_ptr<T> adoptNode(T* node) {
+#ifdef RAPID_ARENA
+  return std::shared_ptr<T>(node, std::default_delete<T>(),
+                            ArenaAllocator<T>());
+#else
+  return std::shared_ptr<T>(node);
+#endif
+}
+
+// constructs a logic node with public constructor, with node and control block
+// in a single allocation (in the arena if RAPID_ARENA is set).
+template <typename T, typename... Args>
+std::shared_ptr<const T> makeNode(Args&&... args) {
+#ifdef RAPID_ARENA
+  return std::allocate_shared<const T>(ArenaAllocator<T>(),
+                                       std::forward<Args>(args)...);
+#else
+  return std::make_shared<const T>(std::forward<Args>(args)...);
+#endif
+}
+
+}  // namespace logic
+
+#endif
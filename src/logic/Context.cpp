@@ -0,0 +1,21 @@
+#include "Context.hpp"
+
+#include <memory>
+#include <utility>
+
+namespace logic {
+
+thread_local std::shared_ptr<Context> Context::_current;
+
+const std::shared_ptr<Context>& Context::currentShared() {
+  if (_current == nullptr) {
+    _current = std::make_shared<Context>();
+  }
+  return _current;
+}
+
+void Context::setCurrent(std::shared_ptr<Context> context) {
+  _current = std::move(context);
+}
+
+}  // namespace logic
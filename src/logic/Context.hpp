@@ -0,0 +1,46 @@
+#ifndef __Context__
+#define __Context__
+
+#include <memory>
+
+#include "Arena.hpp"
+#include "Formula.hpp"
+#include "Signature.hpp"
+#include "Sort.hpp"
+#include "Term.hpp"
+
+namespace logic {
+
+/*
+ * The state of the manager-classes Signature, Sorts, Terms and Formulas, i.e.
+ * everything constructed while generating a problem. The managers operate on
+ * the current context of the calling thread, so that independent problems can
+ * be generated concurrently, each in its own context. Nodes of different
+ * contexts must not be mixed.
+ */
+class Context {
+ public:
+  // the current context of the calling thread. Each thread starts with a new
+  // context.
+  static Context& current() { return *currentShared(); }
+  static const std::shared_ptr<Context>& currentShared();
+  // replaces the current context of the calling thread, e.g. by a new one
+  // before the next problem is generated, or by the context of another thread
+  // to work on its problem
+  static void setCurrent(std::shared_ptr<Context> context);
+
+  // destroyed in reverse order, so formulas and terms go before the sorts,
+  // and the arena holding the nodes goes last
+  Arena arena;
+  Sorts::State sorts;
+  Signature signature;
+  Terms::State terms;
+  Formulas::State formulas;
+
+ private:
+  static thread_local std::shared_ptr<Context> _current;
+};
+
+}  // namespace logic
+
+#endif
@@ -2,10 +2,14 @@
 
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "Context.hpp"
+
 namespace logic {
 
 // hack needed for bison: std::vector has no overload for ostream, but these
@@ -17,138 +21,331 @@ std::ostream& operator<<(
   return ostr;
 }
 
-std::string Formula::stringForLabel(unsigned indentation) const {
-  std::string str = "";
-  if (!label.empty()) {
-    str += std::string(indentation, ' ') + ";" + label + "\n";
+void writeIndentation(std::ostream& ostr, unsigned indentation) {
+  static const std::string spaces(64, ' ');
+  while (indentation > spaces.size()) {
+    ostr.write(spaces.data(), spaces.size());
+    indentation -= spaces.size();
   }
-  return str;
+  ostr.write(spaces.data(), indentation);
 }
 
-std::string PredicateFormula::toSMTLIB(unsigned indentation) const {
-  std::string str = stringForLabel(indentation);
-  str += std::string(indentation, ' ');
-  if (subterms.size() == 0) {
-    str += symbol->toSMTLIB();
-  } else {
-    str += "(" + symbol->toSMTLIB() + " ";
-    for (unsigned i = 0; i < subterms.size(); i++) {
-      str += subterms[i]->toSMTLIB();
-      str += (i == subterms.size() - 1) ? ")" : " ";
-    }
+namespace {
+
+void writeVars(std::ostream& ostr,
+               const std::vector<std::shared_ptr<const Symbol>>& vars) {
+  ostr << "(";
+  for (const auto& var : vars) {
+    ostr << "(" << var->name << " " << var->rngSort->toSMTLIB() << ")";
   }
-  return str;
+  ostr << ")\n";
 }
 
-std::string EqualityFormula::toSMTLIB(unsigned indentation) const {
-  std::string str = stringForLabel(indentation);
-  str += std::string(indentation, ' ');
-  if (polarity) {
-    str += "(= " + left->toSMTLIB() + " " + right->toSMTLIB() + ")";
-  } else {
-    str += "(not (= " + left->toSMTLIB() + " " + right->toSMTLIB() + "))";
+}  // namespace
+
+void Formula::writeLabel(std::ostream& ostr, unsigned indentation) const {
+  if (!label.empty()) {
+    writeIndentation(ostr, indentation);
+    ostr << ";" << label << "\n";
   }
-  return str;
 }
 
-std::string ConjunctionFormula::toSMTLIB(unsigned indentation) const {
-  std::string str = stringForLabel(indentation);
-  if (conj.size() == 0) {
-    return str + std::string(indentation, ' ') + "true";
-  }
-  str += std::string(indentation, ' ') + "(and\n";
-  for (unsigned i = 0; i < conj.size(); i++) {
-    str += conj[i]->toSMTLIB(indentation + 3) + "\n";
-  }
-  str += std::string(indentation, ' ') + ")";
-  return str;
+std::string Formula::toSMTLIB(unsigned indentation) const {
+  std::stringstream str;
+  writeSMTLIB(str, indentation);
+  return str.str();
 }
 
-std::string DisjunctionFormula::toSMTLIB(unsigned indentation) const {
-  std::string str = stringForLabel(indentation);
-  if (disj.size() == 0) {
-    return str + std::string(indentation, ' ') + "false";
-  }
-  str = std::string(indentation, ' ') + "(or\n";
-  for (unsigned i = 0; i < disj.size(); i++) {
-    str += disj[i]->toSMTLIB(indentation + 3) + "\n";
+std::size_t Formula::computeHash(
+    Type type, const Symbol& symbol,
+    const std::vector<std::shared_ptr<const Term>>& subterms) {
+  std::size_t result = hashCombine(std::hash<Type>()(type),
+                                   std::hash<const Symbol>()(symbol));
+  for (const auto& subterm : subterms) {
+    result = hashCombine(result, subterm->hash);
   }
-  str += std::string(indentation, ' ') + ")";
-  return str;
+  return result;
 }
 
-std::string NegationFormula::toSMTLIB(unsigned indentation) const {
-  std::string str = stringForLabel(indentation);
-  str += std::string(indentation, ' ') + "(not\n";
-  str += f->toSMTLIB(indentation + 3) + "\n";
-  str += std::string(indentation, ' ') + ")";
-  return str;
+std::size_t Formula::computeHash(
+    Type type, const std::vector<std::shared_ptr<const Formula>>& subformulas) {
+  std::size_t result = std::hash<Type>()(type);
+  for (const auto& subformula : subformulas) {
+    result = hashCombine(result, subformula->hash);
+  }
+  return result;
 }
 
-std::string ExistentialFormula::toSMTLIB(unsigned indentation) const {
-  std::string str = stringForLabel(indentation);
-  str += std::string(indentation, ' ') + "(exists ";
-
-  // list of quantified variables
-  str += "(";
+std::size_t Formula::computeHash(
+    Type type, const std::vector<std::shared_ptr<const Symbol>>& vars,
+    const Formula& f) {
+  std::size_t result = std::hash<Type>()(type);
   for (const auto& var : vars) {
-    str += "(" + var->name + " " + var->rngSort->toSMTLIB() + ")";
+    result = hashCombine(result, std::hash<const Symbol>()(*var));
   }
-  str += ")\n";
+  return hashCombine(result, f.hash);
+}
 
-  // formula
-  str += f->toSMTLIB(indentation + 3) + "\n";
+std::size_t Formula::computeHash(Type type, const Formula& f) {
+  return hashCombine(std::hash<Type>()(type), f.hash);
+}
 
-  str += std::string(indentation, ' ') + ")";
-  return str;
+std::size_t Formula::computeHash(Type type, const Formula& f1,
+                                 const Formula& f2) {
+  return hashCombine(computeHash(type, f1), f2.hash);
 }
 
-std::string UniversalFormula::toSMTLIB(unsigned indentation) const {
-  std::string str = stringForLabel(indentation);
-  str += std::string(indentation, ' ') + "(forall ";
+std::size_t Formula::computeHash(bool polarity, const Term& left,
+                                 const Term& right) {
+  return hashCombine(
+      hashCombine(hashCombine(std::hash<Type>()(Type::Equality), polarity),
+                  left.hash),
+      right.hash);
+}
 
-  // list of quantified variables
-  str += "(";
-  for (const auto& var : vars) {
-    str += "(" + var->name + " " + var->rngSort->toSMTLIB() + ")";
+#pragma mark - Equality
+
+namespace {
+
+bool equalVars(const std::vector<std::shared_ptr<const Symbol>>& vars1,
+               const std::vector<std::shared_ptr<const Symbol>>& vars2) {
+  if (vars1.size() != vars2.size()) {
+    return false;
+  }
+  for (unsigned i = 0; i < vars1.size(); i++) {
+    if (*vars1[i] != *vars2[i]) {
+      return false;
+    }
   }
-  str += ")\n";
+  return true;
+}
 
-  // formula
-  str += f->toSMTLIB(indentation + 3) + "\n";
+// if deep is false, subformulas are compared by address, otherwise they are
+// compared structurally. Subterms are always compared by address, since terms
+// are hash-consed.
+bool equal(const Formula& f1, const Formula& f2, bool deep);
 
-  str += std::string(indentation, ' ') + ")";
-  return str;
+bool equal(const std::shared_ptr<const Formula>& f1,
+           const std::shared_ptr<const Formula>& f2, bool deep) {
+  return deep ? equal(*f1, *f2, true) : f1 == f2;
 }
 
-std::string ImplicationFormula::toSMTLIB(unsigned indentation) const {
-  std::string str = stringForLabel(indentation);
+bool equal(const std::vector<std::shared_ptr<const Formula>>& fs1,
+           const std::vector<std::shared_ptr<const Formula>>& fs2, bool deep) {
+  if (fs1.size() != fs2.size()) {
+    return false;
+  }
+  for (unsigned i = 0; i < fs1.size(); i++) {
+    if (!equal(fs1[i], fs2[i], deep)) {
+      return false;
+    }
+  }
+  return true;
+}
 
-  str += std::string(indentation, ' ') + "(=>\n";
-  str += f1->toSMTLIB(indentation + 3) + "\n";
-  str += f2->toSMTLIB(indentation + 3) + "\n";
-  str += std::string(indentation, ' ') + ")";
-  return str;
+bool equal(const Formula& f1, const Formula& f2, bool deep) {
+  if (&f1 == &f2) {
+    return true;
+  }
+  if (f1.hash != f2.hash || f1.type() != f2.type()) {
+    return false;
+  }
+  switch (f1.type()) {
+    case Formula::Type::Predicate: {
+      auto& p1 = static_cast<const PredicateFormula&>(f1);
+      auto& p2 = static_cast<const PredicateFormula&>(f2);
+      return *p1.symbol == *p2.symbol && p1.subterms == p2.subterms;
+    }
+    case Formula::Type::Equality: {
+      auto& e1 = static_cast<const EqualityFormula&>(f1);
+      auto& e2 = static_cast<const EqualityFormula&>(f2);
+      return e1.polarity == e2.polarity && e1.left == e2.left &&
+             e1.right == e2.right;
+    }
+    case Formula::Type::Conjunction: {
+      return equal(static_cast<const ConjunctionFormula&>(f1).conj,
+                   static_cast<const ConjunctionFormula&>(f2).conj, deep);
+    }
+    case Formula::Type::Disjunction: {
+      return equal(static_cast<const DisjunctionFormula&>(f1).disj,
+                   static_cast<const DisjunctionFormula&>(f2).disj, deep);
+    }
+    case Formula::Type::Negation: {
+      return equal(static_cast<const NegationFormula&>(f1).f,
+                   static_cast<const NegationFormula&>(f2).f, deep);
+    }
+    case Formula::Type::Existential: {
+      auto& q1 = static_cast<const ExistentialFormula&>(f1);
+      auto& q2 = static_cast<const ExistentialFormula&>(f2);
+      return equalVars(q1.vars, q2.vars) && equal(q1.f, q2.f, deep);
+    }
+    case Formula::Type::Universal: {
+      auto& q1 = static_cast<const UniversalFormula&>(f1);
+      auto& q2 = static_cast<const UniversalFormula&>(f2);
+      return equalVars(q1.vars, q2.vars) && equal(q1.f, q2.f, deep);
+    }
+    case Formula::Type::Implication: {
+      auto& i1 = static_cast<const ImplicationFormula&>(f1);
+      auto& i2 = static_cast<const ImplicationFormula&>(f2);
+      return equal(i1.f1, i2.f1, deep) && equal(i1.f2, i2.f2, deep);
+    }
+    case Formula::Type::Equivalence: {
+      auto& e1 = static_cast<const EquivalenceFormula&>(f1);
+      auto& e2 = static_cast<const EquivalenceFormula&>(f2);
+      return equal(e1.f1, e2.f1, deep) && equal(e1.f2, e2.f2, deep);
+    }
+    case Formula::Type::True:
+    case Formula::Type::False: {
+      return true;
+    }
+  }
+  assert(false);
+  return false;
 }
 
-std::string EquivalenceFormula::toSMTLIB(unsigned indentation) const {
-  std::string str = stringForLabel(indentation);
+}  // namespace
 
-  str += std::string(indentation, ' ') + "(=\n";
-  str += f1->toSMTLIB(indentation + 3) + "\n";
-  str += f2->toSMTLIB(indentation + 3) + "\n";
-  str += std::string(indentation, ' ') + ")";
-  return str;
+bool operator==(const Formula& f1, const Formula& f2) {
+  return equal(f1, f2, true);
 }
+bool operator!=(const Formula& f1, const Formula& f2) { return !(f1 == f2); }
 
-std::string TrueFormula::toSMTLIB(unsigned indentation) const {
-  std::string str = stringForLabel(indentation);
-  return str + std::string(indentation, ' ') + "true";
+void PredicateFormula::writeSMTLIB(std::ostream& ostr,
+                                   unsigned indentation) const {
+  writeLabel(ostr, indentation);
+  writeIndentation(ostr, indentation);
+  if (subterms.size() == 0) {
+    symbol->writeSMTLIB(ostr);
+  } else {
+    ostr << "(";
+    symbol->writeSMTLIB(ostr);
+    for (const auto& subterm : subterms) {
+      ostr << " ";
+      subterm->writeSMTLIB(ostr);
+    }
+    ostr << ")";
+  }
+}
+
+void EqualityFormula::writeSMTLIB(std::ostream& ostr,
+                                  unsigned indentation) const {
+  writeLabel(ostr, indentation);
+  writeIndentation(ostr, indentation);
+  ostr << (polarity ? "(= " : "(not (= ");
+  left->writeSMTLIB(ostr);
+  ostr << " ";
+  right->writeSMTLIB(ostr);
+  ostr << (polarity ? ")" : "))");
 }
 
-std::string FalseFormula::toSMTLIB(unsigned indentation) const {
-  std::string str = stringForLabel(indentation);
-  return str + std::string(indentation, ' ') + "false";
+void ConjunctionFormula::writeSMTLIB(std::ostream& ostr,
+                                     unsigned indentation) const {
+  writeLabel(ostr, indentation);
+  writeIndentation(ostr, indentation);
+  if (conj.size() == 0) {
+    ostr << "true";
+    return;
+  }
+  ostr << "(and\n";
+  for (const auto& conjunct : conj) {
+    conjunct->writeSMTLIB(ostr, indentation + 3);
+    ostr << "\n";
+  }
+  writeIndentation(ostr, indentation);
+  ostr << ")";
+}
+
+void DisjunctionFormula::writeSMTLIB(std::ostream& ostr,
+                                     unsigned indentation) const {
+  if (disj.size() == 0) {
+    writeLabel(ostr, indentation);
+    writeIndentation(ostr, indentation);
+    ostr << "false";
+    return;
+  }
+  // note: the label of a non-empty disjunction is not printed
+  writeIndentation(ostr, indentation);
+  ostr << "(or\n";
+  for (const auto& disjunct : disj) {
+    disjunct->writeSMTLIB(ostr, indentation + 3);
+    ostr << "\n";
+  }
+  writeIndentation(ostr, indentation);
+  ostr << ")";
+}
+
+void NegationFormula::writeSMTLIB(std::ostream& ostr,
+                                  unsigned indentation) const {
+  writeLabel(ostr, indentation);
+  writeIndentation(ostr, indentation);
+  ostr << "(not\n";
+  f->writeSMTLIB(ostr, indentation + 3);
+  ostr << "\n";
+  writeIndentation(ostr, indentation);
+  ostr << ")";
+}
+
+void ExistentialFormula::writeSMTLIB(std::ostream& ostr,
+                                     unsigned indentation) const {
+  writeLabel(ostr, indentation);
+  writeIndentation(ostr, indentation);
+  ostr << "(exists ";
+  writeVars(ostr, vars);
+  f->writeSMTLIB(ostr, indentation + 3);
+  ostr << "\n";
+  writeIndentation(ostr, indentation);
+  ostr << ")";
+}
+
+void UniversalFormula::writeSMTLIB(std::ostream& ostr,
+                                   unsigned indentation) const {
+  writeLabel(ostr, indentation);
+  writeIndentation(ostr, indentation);
+  ostr << "(forall ";
+  writeVars(ostr, vars);
+  f->writeSMTLIB(ostr, indentation + 3);
+  ostr << "\n";
+  writeIndentation(ostr, indentation);
+  ostr << ")";
+}
+
+void ImplicationFormula::writeSMTLIB(std::ostream& ostr,
+                                     unsigned indentation) const {
+  writeLabel(ostr, indentation);
+  writeIndentation(ostr, indentation);
+  ostr << "(=>\n";
+  f1->writeSMTLIB(ostr, indentation + 3);
+  ostr << "\n";
+  f2->writeSMTLIB(ostr, indentation + 3);
+  ostr << "\n";
+  writeIndentation(ostr, indentation);
+  ostr << ")";
+}
+
+void EquivalenceFormula::writeSMTLIB(std::ostream& ostr,
+                                     unsigned indentation) const {
+  writeLabel(ostr, indentation);
+  writeIndentation(ostr, indentation);
+  ostr << "(=\n";
+  f1->writeSMTLIB(ostr, indentation + 3);
+  ostr << "\n";
+  f2->writeSMTLIB(ostr, indentation + 3);
+  ostr << "\n";
+  writeIndentation(ostr, indentation);
+  ostr << ")";
+}
+
+void TrueFormula::writeSMTLIB(std::ostream& ostr, unsigned indentation) const {
+  writeLabel(ostr, indentation);
+  writeIndentation(ostr, indentation);
+  ostr << "true";
+}
+
+void FalseFormula::writeSMTLIB(std::ostream& ostr,
+                               unsigned indentation) const {
+  writeLabel(ostr, indentation);
+  writeIndentation(ostr, indentation);
+  ostr << "false";
 }
 
 std::string PredicateFormula::prettyString(unsigned indentation) const {
@@ -255,65 +452,213 @@ std::string FalseFormula::prettyString(unsigned indentation) const {
 }
 
 #pragma mark - Formulas
+
+bool Formulas::FormulaKey::operator==(const FormulaKey& other) const {
+  if (type != other.type || hash != other.hash || polarity != other.polarity ||
+      left != other.left || right != other.right || f1 != other.f1 ||
+      f2 != other.f2) {
+    return false;
+  }
+  if (symbol != nullptr && *symbol != *other.symbol) {
+    return false;
+  }
+  // vectors of shared pointers compare their elements by address
+  if (subterms != nullptr && *subterms != *other.subterms) {
+    return false;
+  }
+  if (subformulas != nullptr && *subformulas != *other.subformulas) {
+    return false;
+  }
+  return vars == nullptr || equalVars(*vars, *other.vars);
+}
+
+Formulas::FormulaKey Formulas::keyOf(const Formula& f) {
+  FormulaKey key(f.type(), f.hash);
+  switch (f.type()) {
+    case Formula::Type::Predicate: {
+      auto& predicate = static_cast<const PredicateFormula&>(f);
+      key.symbol = predicate.symbol.get();
+      key.subterms = &predicate.subterms;
+      break;
+    }
+    case Formula::Type::Equality: {
+      auto& eq = static_cast<const EqualityFormula&>(f);
+      key.polarity = eq.polarity;
+      key.left = eq.left.get();
+      key.right = eq.right.get();
+      break;
+    }
+    case Formula::Type::Conjunction: {
+      key.subformulas = &static_cast<const ConjunctionFormula&>(f).conj;
+      break;
+    }
+    case Formula::Type::Disjunction: {
+      key.subformulas = &static_cast<const DisjunctionFormula&>(f).disj;
+      break;
+    }
+    case Formula::Type::Negation: {
+      key.f1 = static_cast<const NegationFormula&>(f).f.get();
+      break;
+    }
+    case Formula::Type::Existential: {
+      auto& quantified = static_cast<const ExistentialFormula&>(f);
+      key.vars = &quantified.vars;
+      key.f1 = quantified.f.get();
+      break;
+    }
+    case Formula::Type::Universal: {
+      auto& quantified = static_cast<const UniversalFormula&>(f);
+      key.vars = &quantified.vars;
+      key.f1 = quantified.f.get();
+      break;
+    }
+    case Formula::Type::Implication: {
+      auto& implication = static_cast<const ImplicationFormula&>(f);
+      key.f1 = implication.f1.get();
+      key.f2 = implication.f2.get();
+      break;
+    }
+    case Formula::Type::Equivalence: {
+      auto& equivalence = static_cast<const EquivalenceFormula&>(f);
+      key.f1 = equivalence.f1.get();
+      key.f2 = equivalence.f2.get();
+      break;
+    }
+    case Formula::Type::True:
+    case Formula::Type::False: {
+      break;
+    }
+  }
+  return key;
+}
+
+template <typename T, typename... Args>
+std::shared_ptr<const Formula> Formulas::fetchOrMake(const std::string& label,
+                                                     const FormulaKey& key,
+                                                     Args&&... args) {
+  if (!label.empty()) {
+    return makeNode<T>(std::forward<Args>(args)...);
+  }
+
+  // only allocate the formula if it doesn't exist yet
+  auto& formulas = Context::current().formulas.formulas;
+  auto it = formulas.find(key);
+  if (it != formulas.end()) {
+    return it->second;
+  }
+  auto f = makeNode<T>(std::forward<Args>(args)...);
+  formulas.emplace(keyOf(*f), f);
+  return f;
+}
+
 std::shared_ptr<const Formula> Formulas::predicate(
     std::string name, std::vector<std::shared_ptr<const Term>> subterms,
     std::string label, bool noDeclaration) {
-  std::vector<const Sort*> subtermSorts;
-  for (const auto& subterm : subterms) {
-    subtermSorts.push_back(subterm->symbol->rngSort);
+  auto symbol = Signature::tryFetch(name);
+  if (symbol == nullptr || symbol->argSorts.size() != subterms.size()) {
+    std::vector<const Sort*> subtermSorts;
+    for (const auto& subterm : subterms) {
+      subtermSorts.push_back(subterm->symbol->rngSort);
+    }
+    symbol = Signature::fetchOrAdd(name, subtermSorts, Sorts::boolSort(),
+                                   false, noDeclaration);
+  }
+  // fetchOrAdd also checks the argument sorts, which the fast path skips
+  for (unsigned i = 0; i < subterms.size(); ++i) {
+    assert(subterms[i]->symbol->rngSort == symbol->argSorts[i]);
   }
-  auto symbol = Signature::fetchOrAdd(name, subtermSorts, Sorts::boolSort(),
-                                      false, noDeclaration);
-  return std::make_shared<const PredicateFormula>(symbol, subterms, label);
+  assert(!symbol->isLemmaPredicate);
+  assert(symbol->noDeclaration == noDeclaration);
+  return predicate(symbol, std::move(subterms), label);
+}
+std::shared_ptr<const Formula> Formulas::predicate(
+    std::shared_ptr<const Symbol> symbol,
+    std::vector<std::shared_ptr<const Term>> subterms, std::string label) {
+  FormulaKey key(Formula::Type::Predicate,
+                 Formula::computeHash(Formula::Type::Predicate, *symbol,
+                                      subterms));
+  key.symbol = symbol.get();
+  key.subterms = &subterms;
+  return fetchOrMake<PredicateFormula>(label, key, symbol, std::move(subterms),
+                                       label);
 }
 std::shared_ptr<const Formula> Formulas::lemmaPredicate(
     std::string name, std::vector<std::shared_ptr<const Term>> subterms,
     std::string label) {
-  std::vector<const Sort*> subtermSorts;
-  for (const auto& subterm : subterms) {
-    subtermSorts.push_back(subterm->symbol->rngSort);
+  auto symbol = Signature::tryFetch(name);
+  if (symbol == nullptr || symbol->argSorts.size() != subterms.size()) {
+    std::vector<const Sort*> subtermSorts;
+    for (const auto& subterm : subterms) {
+      subtermSorts.push_back(subterm->symbol->rngSort);
+    }
+    symbol = Signature::fetchOrAdd(name, subtermSorts, Sorts::boolSort(), true,
+                                   false);
+  }
+  // fetchOrAdd also checks the argument sorts, which the fast path skips
+  for (unsigned i = 0; i < subterms.size(); ++i) {
+    assert(subterms[i]->symbol->rngSort == symbol->argSorts[i]);
   }
-  auto symbol =
-      Signature::fetchOrAdd(name, subtermSorts, Sorts::boolSort(), true, false);
-  return std::make_shared<const PredicateFormula>(symbol, subterms, label);
+  assert(symbol->isLemmaPredicate);
+  assert(!symbol->noDeclaration);
+  return predicate(symbol, std::move(subterms), label);
 }
 
 std::shared_ptr<const Formula> Formulas::equality(
     std::shared_ptr<const Term> left, std::shared_ptr<const Term> right,
     std::string label) {
-  return std::make_shared<const EqualityFormula>(true, left, right, label);
+  FormulaKey key(Formula::Type::Equality,
+                 Formula::computeHash(true, *left, *right));
+  key.left = left.get();
+  key.right = right.get();
+  return fetchOrMake<EqualityFormula>(label, key, true, left, right, label);
 }
 
 std::shared_ptr<const Formula> Formulas::disequality(
     std::shared_ptr<const Term> left, std::shared_ptr<const Term> right,
     std::string label) {
-  auto eq = std::make_shared<const EqualityFormula>(true, left, right);
-  return std::make_shared<const NegationFormula>(eq, label);
+  return negation(equality(left, right), label);
 }
 
 std::shared_ptr<const Formula> Formulas::negation(
     std::shared_ptr<const Formula> f, std::string label) {
-  return std::make_shared<const NegationFormula>(f, label);
+  FormulaKey key(Formula::Type::Negation,
+                 Formula::computeHash(Formula::Type::Negation, *f));
+  key.f1 = f.get();
+  return fetchOrMake<NegationFormula>(label, key, f, label);
 }
 
 std::shared_ptr<const Formula> Formulas::conjunction(
     std::vector<std::shared_ptr<const Formula>> conj, std::string label) {
-  return std::make_shared<const ConjunctionFormula>(conj, label);
+  FormulaKey key(Formula::Type::Conjunction,
+                 Formula::computeHash(Formula::Type::Conjunction, conj));
+  key.subformulas = &conj;
+  return fetchOrMake<ConjunctionFormula>(label, key, std::move(conj), label);
 }
 std::shared_ptr<const Formula> Formulas::disjunction(
     std::vector<std::shared_ptr<const Formula>> disj, std::string label) {
-  return std::make_shared<const DisjunctionFormula>(disj, label);
+  FormulaKey key(Formula::Type::Disjunction,
+                 Formula::computeHash(Formula::Type::Disjunction, disj));
+  key.subformulas = &disj;
+  return fetchOrMake<DisjunctionFormula>(label, key, std::move(disj), label);
 }
 
 std::shared_ptr<const Formula> Formulas::implication(
     std::shared_ptr<const Formula> f1, std::shared_ptr<const Formula> f2,
     std::string label) {
-  return std::make_shared<const ImplicationFormula>(f1, f2, label);
+  FormulaKey key(Formula::Type::Implication,
+                 Formula::computeHash(Formula::Type::Implication, *f1, *f2));
+  key.f1 = f1.get();
+  key.f2 = f2.get();
+  return fetchOrMake<ImplicationFormula>(label, key, f1, f2, label);
 }
 std::shared_ptr<const Formula> Formulas::equivalence(
     std::shared_ptr<const Formula> f1, std::shared_ptr<const Formula> f2,
     std::string label) {
-  return std::make_shared<const EquivalenceFormula>(f1, f2, label);
+  FormulaKey key(Formula::Type::Equivalence,
+                 Formula::computeHash(Formula::Type::Equivalence, *f1, *f2));
+  key.f1 = f1.get();
+  key.f2 = f2.get();
+  return fetchOrMake<EquivalenceFormula>(label, key, f1, f2, label);
 }
 
 std::shared_ptr<const Formula> Formulas::existential(
@@ -322,8 +667,12 @@ std::shared_ptr<const Formula> Formulas::existential(
   if (vars.empty()) {
     return copyWithLabel(f, label);
   } else {
-    return std::make_shared<const ExistentialFormula>(std::move(vars), f,
-                                                      label);
+    FormulaKey key(Formula::Type::Existential,
+                   Formula::computeHash(Formula::Type::Existential, vars, *f));
+    key.vars = &vars;
+    key.f1 = f.get();
+    return fetchOrMake<ExistentialFormula>(label, key, std::move(vars), f,
+                                           label);
   }
 }
 std::shared_ptr<const Formula> Formulas::universal(
@@ -332,15 +681,24 @@ std::shared_ptr<const Formula> Formulas::universal(
   if (vars.empty()) {
     return copyWithLabel(f, label);
   } else {
-    return std::make_shared<const UniversalFormula>(std::move(vars), f, label);
+    FormulaKey key(Formula::Type::Universal,
+                   Formula::computeHash(Formula::Type::Universal, vars, *f));
+    key.vars = &vars;
+    key.f1 = f.get();
+    return fetchOrMake<UniversalFormula>(label, key, std::move(vars), f,
+                                         label);
   }
 }
 
 std::shared_ptr<const Formula> Formulas::trueFormula(std::string label) {
-  return std::make_shared<const TrueFormula>(label);
+  FormulaKey key(Formula::Type::True,
+                 std::hash<Formula::Type>()(Formula::Type::True));
+  return fetchOrMake<TrueFormula>(label, key, label);
 }
 std::shared_ptr<const Formula> Formulas::falseFormula(std::string label) {
-  return std::make_shared<const FalseFormula>(label);
+  FormulaKey key(Formula::Type::False,
+                 std::hash<Formula::Type>()(Formula::Type::False));
+  return fetchOrMake<FalseFormula>(label, key, label);
 }
 
 std::shared_ptr<const Formula> Formulas::equalitySimp(
@@ -472,8 +830,7 @@ std::shared_ptr<const Formula> Formulas::copyWithLabel(
     case logic::Formula::Type::Predicate: {
       auto castedFormula =
           std::static_pointer_cast<const logic::PredicateFormula>(f);
-      return std::make_shared<const PredicateFormula>(
-          castedFormula->symbol, castedFormula->subterms, label);
+      return predicate(castedFormula->symbol, castedFormula->subterms, label);
     }
     case logic::Formula::Type::Equality: {
       auto castedFormula =
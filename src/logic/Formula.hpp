@@ -5,6 +5,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -13,11 +14,18 @@
 namespace logic {
 
 class Formula {
+  friend class Formulas;
+
  public:
-  Formula(std::string label) : label(label) {}
+  Formula(std::string label, std::size_t hash) : label(label), hash(hash) {}
   virtual ~Formula() {}
   const std::string label;
 
+  // structural hash of the formula, computed once during construction from
+  // the hashes of the subformulas and subterms. Labels are not part of the
+  // structure, so formulas differing only in labels have the same hash.
+  const std::size_t hash;
+
   enum class Type {
     Predicate,
     Equality,
@@ -33,13 +41,43 @@ class Formula {
   };
   virtual Type type() const = 0;
 
-  virtual std::string toSMTLIB(unsigned indentation = 0) const = 0;
+  // writes the formula in SMTLIB syntax directly into ostr
+  virtual void writeSMTLIB(std::ostream& ostr,
+                           unsigned indentation = 0) const = 0;
+  std::string toSMTLIB(unsigned indentation = 0) const;
   virtual std::string prettyString(unsigned indentation = 0) const = 0;
 
+  // writes the label as SMTLIB-comment (if the formula has a label)
+  void writeLabel(std::ostream& ostr, unsigned indentation) const;
+
  protected:
-  std::string stringForLabel(unsigned indentation) const;
+
+  static std::size_t computeHash(
+      Type type, const Symbol& symbol,
+      const std::vector<std::shared_ptr<const Term>>& subterms);
+  static std::size_t computeHash(
+      Type type,
+      const std::vector<std::shared_ptr<const Formula>>& subformulas);
+  static std::size_t computeHash(
+      Type type, const std::vector<std::shared_ptr<const Symbol>>& vars,
+      const Formula& f);
+  // the same as for a vector containing the given subformulas
+  static std::size_t computeHash(Type type, const Formula& f);
+  static std::size_t computeHash(Type type, const Formula& f1,
+                                 const Formula& f2);
+  static std::size_t computeHash(bool polarity, const Term& left,
+                                 const Term& right);
 };
 
+// writes 'indentation' many spaces without constructing a string
+void writeIndentation(std::ostream& ostr, unsigned indentation);
+
+// structural equality of formulas, which ignores labels.
+// formulas are hash-consed by Formulas, so for formulas without labels
+// equality usually reduces to a pointer-comparison.
+bool operator==(const Formula& f1, const Formula& f2);
+bool operator!=(const Formula& f1, const Formula& f2);
+
 // hack needed for bison: std::vector has no overload for ostream, but these
 // overloads are needed for bison
 std::ostream& operator<<(
@@ -53,7 +91,9 @@ class PredicateFormula : public Formula {
   PredicateFormula(std::shared_ptr<const Symbol> symbol,
                    std::vector<std::shared_ptr<const Term>> subterms,
                    std::string label = "")
-      : Formula(label), symbol(symbol), subterms(subterms) {
+      : Formula(label, computeHash(Type::Predicate, *symbol, subterms)),
+        symbol(symbol),
+        subterms(subterms) {
     assert(symbol->argSorts.size() == subterms.size());
     for (int i = 0; i < symbol->argSorts.size(); ++i) {
       assert(symbol->argSorts[i] == this->subterms[i]->symbol->rngSort);
@@ -64,7 +104,8 @@ class PredicateFormula : public Formula {
   const std::vector<std::shared_ptr<const Term>> subterms;
 
   Type type() const override { return Formula::Type::Predicate; }
-  std::string toSMTLIB(unsigned indentation = 0) const override;
+  void writeSMTLIB(std::ostream& ostr,
+                   unsigned indentation = 0) const override;
   std::string prettyString(unsigned indentation = 0) const override;
 };
 
@@ -75,14 +116,18 @@ class EqualityFormula : public Formula {
   // TODO: refactor polarity into explicit negation everywhere
   EqualityFormula(bool polarity, std::shared_ptr<const Term> left,
                   std::shared_ptr<const Term> right, std::string label = "")
-      : Formula(label), polarity(polarity), left(left), right(right) {}
+      : Formula(label, computeHash(polarity, *left, *right)),
+        polarity(polarity),
+        left(left),
+        right(right) {}
 
   const bool polarity;
   const std::shared_ptr<const Term> left;
   const std::shared_ptr<const Term> right;
 
   Type type() const override { return Formula::Type::Equality; }
-  std::string toSMTLIB(unsigned indentation = 0) const override;
+  void writeSMTLIB(std::ostream& ostr,
+                   unsigned indentation = 0) const override;
   std::string prettyString(unsigned indentation = 0) const override;
 };
 
@@ -92,12 +137,13 @@ class ConjunctionFormula : public Formula {
  public:
   ConjunctionFormula(std::vector<std::shared_ptr<const Formula>> conj,
                      std::string label = "")
-      : Formula(label), conj(conj) {}
+      : Formula(label, computeHash(Type::Conjunction, conj)), conj(conj) {}
 
   const std::vector<std::shared_ptr<const Formula>> conj;
 
   Type type() const override { return Formula::Type::Conjunction; }
-  std::string toSMTLIB(unsigned indentation = 0) const override;
+  void writeSMTLIB(std::ostream& ostr,
+                   unsigned indentation = 0) const override;
   std::string prettyString(unsigned indentation = 0) const override;
 };
 
@@ -107,12 +153,13 @@ class DisjunctionFormula : public Formula {
  public:
   DisjunctionFormula(std::vector<std::shared_ptr<const Formula>> disj,
                      std::string label = "")
-      : Formula(label), disj(disj) {}
+      : Formula(label, computeHash(Type::Disjunction, disj)), disj(disj) {}
 
   const std::vector<std::shared_ptr<const Formula>> disj;
 
   Type type() const override { return Formula::Type::Disjunction; }
-  std::string toSMTLIB(unsigned indentation = 0) const override;
+  void writeSMTLIB(std::ostream& ostr,
+                   unsigned indentation = 0) const override;
   std::string prettyString(unsigned indentation = 0) const override;
 };
 
@@ -121,12 +168,13 @@ class NegationFormula : public Formula {
 
  public:
   NegationFormula(std::shared_ptr<const Formula> f, std::string label = "")
-      : Formula(label), f(f) {}
+      : Formula(label, computeHash(Type::Negation, *f)), f(f) {}
 
   const std::shared_ptr<const Formula> f;
 
   Type type() const override { return Formula::Type::Negation; }
-  std::string toSMTLIB(unsigned indentation = 0) const override;
+  void writeSMTLIB(std::ostream& ostr,
+                   unsigned indentation = 0) const override;
   std::string prettyString(unsigned indentation = 0) const override;
 };
 
@@ -136,7 +184,9 @@ class ExistentialFormula : public Formula {
  public:
   ExistentialFormula(std::vector<std::shared_ptr<const Symbol>> vars,
                      std::shared_ptr<const Formula> f, std::string label = "")
-      : Formula(label), vars(std::move(vars)), f(f) {
+      : Formula(label, computeHash(Type::Existential, vars, *f)),
+        vars(std::move(vars)),
+        f(f) {
     for (const auto& var : vars) {
       assert(var->argSorts.empty());
     }
@@ -146,7 +196,8 @@ class ExistentialFormula : public Formula {
   const std::shared_ptr<const Formula> f;
 
   Type type() const override { return Formula::Type::Existential; }
-  std::string toSMTLIB(unsigned indentation = 0) const override;
+  void writeSMTLIB(std::ostream& ostr,
+                   unsigned indentation = 0) const override;
   std::string prettyString(unsigned indentation = 0) const override;
 };
 
@@ -156,7 +207,9 @@ class UniversalFormula : public Formula {
  public:
   UniversalFormula(std::vector<std::shared_ptr<const Symbol>> vars,
                    std::shared_ptr<const Formula> f, std::string label = "")
-      : Formula(label), vars(std::move(vars)), f(f) {
+      : Formula(label, computeHash(Type::Universal, vars, *f)),
+        vars(std::move(vars)),
+        f(f) {
     for (const auto& var : vars) {
       assert(var->argSorts.empty());
     }
@@ -166,7 +219,8 @@ class UniversalFormula : public Formula {
   const std::shared_ptr<const Formula> f;
 
   Type type() const override { return Formula::Type::Universal; }
-  std::string toSMTLIB(unsigned indentation = 0) const override;
+  void writeSMTLIB(std::ostream& ostr,
+                   unsigned indentation = 0) const override;
   std::string prettyString(unsigned indentation = 0) const override;
 };
 
@@ -176,13 +230,16 @@ class ImplicationFormula : public Formula {
  public:
   ImplicationFormula(std::shared_ptr<const Formula> f1,
                      std::shared_ptr<const Formula> f2, std::string label = "")
-      : Formula(label), f1(f1), f2(f2) {}
+      : Formula(label, computeHash(Type::Implication, *f1, *f2)),
+        f1(f1),
+        f2(f2) {}
 
   const std::shared_ptr<const Formula> f1;
   const std::shared_ptr<const Formula> f2;
 
   Type type() const override { return Formula::Type::Implication; }
-  std::string toSMTLIB(unsigned indentation = 0) const override;
+  void writeSMTLIB(std::ostream& ostr,
+                   unsigned indentation = 0) const override;
   std::string prettyString(unsigned indentation = 0) const override;
 };
 
@@ -192,13 +249,16 @@ class EquivalenceFormula : public Formula {
  public:
   EquivalenceFormula(std::shared_ptr<const Formula> f1,
                      std::shared_ptr<const Formula> f2, std::string label = "")
-      : Formula(label), f1(f1), f2(f2) {}
+      : Formula(label, computeHash(Type::Equivalence, *f1, *f2)),
+        f1(f1),
+        f2(f2) {}
 
   const std::shared_ptr<const Formula> f1;
   const std::shared_ptr<const Formula> f2;
 
   Type type() const override { return Formula::Type::Equivalence; }
-  std::string toSMTLIB(unsigned indentation = 0) const override;
+  void writeSMTLIB(std::ostream& ostr,
+                   unsigned indentation = 0) const override;
   std::string prettyString(unsigned indentation = 0) const override;
 };
 
@@ -206,10 +266,12 @@ class TrueFormula : public Formula {
   friend class Formulas;
 
  public:
-  TrueFormula(std::string label = "") : Formula(label) {}
+  TrueFormula(std::string label = "")
+      : Formula(label, std::hash<Type>()(Type::True)) {}
 
   Type type() const override { return Formula::Type::True; }
-  std::string toSMTLIB(unsigned indentation = 0) const override;
+  void writeSMTLIB(std::ostream& ostr,
+                   unsigned indentation = 0) const override;
   std::string prettyString(unsigned indentation = 0) const override;
 };
 
@@ -217,25 +279,36 @@ class FalseFormula : public Formula {
   friend class Formulas;
 
  public:
-  FalseFormula(std::string label = "") : Formula(label) {}
+  FalseFormula(std::string label = "")
+      : Formula(label, std::hash<Type>()(Type::False)) {}
 
   Type type() const override { return Formula::Type::False; }
-  std::string toSMTLIB(unsigned indentation = 0) const override;
+  void writeSMTLIB(std::ostream& ostr,
+                   unsigned indentation = 0) const override;
   std::string prettyString(unsigned indentation = 0) const override;
 };
 inline std::ostream& operator<<(std::ostream& ostr, const Formula& e) {
-  ostr << e.toSMTLIB();
+  e.writeSMTLIB(ostr);
   return ostr;
 }
 
 #pragma mark - Formulas
 
-// We use Formulas as a manager-class for Formula-instances
+// We use Formulas as a manager-class for Formula-instances.
+// Formulas without label are hash-consed: constructing such a formula which is
+// structurally equal to a previously constructed one returns the previously
+// constructed instance. Labels are kept outside of this identity: labeled
+// formulas are always constructed freshly (while their subformulas are still
+// shared).
 class Formulas {
  public:
   static std::shared_ptr<const Formula> predicate(
       std::string name, std::vector<std::shared_ptr<const Term>> subterms,
       std::string label = "", bool noDeclaration = false);
+  static std::shared_ptr<const Formula> predicate(
+      std::shared_ptr<const Symbol> symbol,
+      std::vector<std::shared_ptr<const Term>> subterms,
+      std::string label = "");
   static std::shared_ptr<const Formula> lemmaPredicate(
       std::string name, std::vector<std::shared_ptr<const Term>> subterms,
       std::string label = "");
@@ -304,9 +377,57 @@ class Formulas {
       std::vector<std::shared_ptr<const Symbol>> vars,
       std::shared_ptr<const Formula> f, std::string label = "");
 
- private:
+  // returns a formula structurally equal to f, but labeled with label
   static std::shared_ptr<const Formula> copyWithLabel(
       std::shared_ptr<const Formula> f, std::string label);
+
+ private:
+  // identifies an unlabeled formula by its type and its direct parts, so that
+  // an existing formula can be found before a new one is constructed. The
+  // parts are compared by address, which is sufficient since they are already
+  // hash-consed. Parts which formulas of the type don't have are left empty.
+  struct FormulaKey {
+    Formula::Type type;
+    std::size_t hash;  // structural hash of the formula
+    bool polarity = true;
+    const Symbol* symbol = nullptr;
+    const Term* left = nullptr;
+    const Term* right = nullptr;
+    const Formula* f1 = nullptr;
+    const Formula* f2 = nullptr;
+    const std::vector<std::shared_ptr<const Term>>* subterms = nullptr;
+    const std::vector<std::shared_ptr<const Formula>>* subformulas = nullptr;
+    const std::vector<std::shared_ptr<const Symbol>>* vars = nullptr;
+
+    FormulaKey(Formula::Type type, std::size_t hash) : type(type), hash(hash) {}
+    bool operator==(const FormulaKey& other) const;
+  };
+  struct FormulaKeyHash {
+    std::size_t operator()(const FormulaKey& key) const { return key.hash; }
+  };
+
+  // the key of the existing formula f, pointing into f
+  static FormulaKey keyOf(const Formula& f);
+
+  // returns the existing formula with the given key if the formula is
+  // unlabeled, otherwise constructs a new formula of type T from args (the
+  // last of which is the label). Labeled formulas are always constructed
+  // freshly.
+  template <typename T, typename... Args>
+  static std::shared_ptr<const Formula> fetchOrMake(const std::string& label,
+                                                    const FormulaKey& key,
+                                                    Args&&... args);
+
+ public:
+  // the formulas of a Context
+  class State {
+    friend class Formulas;
+
+    // collects all unlabeled formulas constructed so far
+    std::unordered_map<FormulaKey, std::shared_ptr<const Formula>,
+                       FormulaKeyHash>
+        formulas;
+  };
 };
 }  // namespace logic
 
@@ -0,0 +1,251 @@
+#include "FormulaVisitor.hpp"
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+namespace logic {
+
+#pragma mark - FormulaVisitor
+
+void FormulaVisitor::visit(const Formula& f) {
+  if (stopped || !visitedFormulas.insert(&f).second) {
+    return;
+  }
+  if (!preVisit(f) || stopped) {
+    return;
+  }
+
+  switch (f.type()) {
+    case Formula::Type::Predicate: {
+      for (const auto& subterm :
+           static_cast<const PredicateFormula&>(f).subterms) {
+        visit(*subterm);
+      }
+      break;
+    }
+    case Formula::Type::Equality: {
+      auto& castedFormula = static_cast<const EqualityFormula&>(f);
+      visit(*castedFormula.left);
+      visit(*castedFormula.right);
+      break;
+    }
+    case Formula::Type::Conjunction: {
+      auto& castedFormula = static_cast<const ConjunctionFormula&>(f);
+      for (const auto& conjunct : castedFormula.conj) {
+        visit(*conjunct);
+      }
+      break;
+    }
+    case Formula::Type::Disjunction: {
+      auto& castedFormula = static_cast<const DisjunctionFormula&>(f);
+      for (const auto& disjunct : castedFormula.disj) {
+        visit(*disjunct);
+      }
+      break;
+    }
+    case Formula::Type::Negation: {
+      visit(*static_cast<const NegationFormula&>(f).f);
+      break;
+    }
+    case Formula::Type::Existential: {
+      visit(*static_cast<const ExistentialFormula&>(f).f);
+      break;
+    }
+    case Formula::Type::Universal: {
+      visit(*static_cast<const UniversalFormula&>(f).f);
+      break;
+    }
+    case Formula::Type::Implication: {
+      auto& castedFormula = static_cast<const ImplicationFormula&>(f);
+      visit(*castedFormula.f1);
+      visit(*castedFormula.f2);
+      break;
+    }
+    case Formula::Type::Equivalence: {
+      auto& castedFormula = static_cast<const EquivalenceFormula&>(f);
+      visit(*castedFormula.f1);
+      visit(*castedFormula.f2);
+      break;
+    }
+    case Formula::Type::True:
+    case Formula::Type::False: {
+      break;
+    }
+  }
+
+  if (!stopped) {
+    postVisit(f);
+  }
+}
+
+void FormulaVisitor::visit(const Term& t) {
+  if (stopped || !visitedTerms.insert(&t).second) {
+    return;
+  }
+  if (!preVisit(t) || stopped) {
+    return;
+  }
+
+  if (t.type() == Term::Type::FuncTerm) {
+    for (const auto& subterm : static_cast<const FuncTerm&>(t).subterms) {
+      visit(*subterm);
+    }
+  }
+
+  if (!stopped) {
+    postVisit(t);
+  }
+}
+
+#pragma mark - FormulaRewriter
+
+std::shared_ptr<const Formula> FormulaRewriter::rewrite(
+    const std::shared_ptr<const Formula>& f) {
+  auto it = rewrittenFormulas.find(f);
+  if (it != rewrittenFormulas.end()) {
+    return it->second;
+  }
+
+  auto result = preRewrite(f);
+  if (result == nullptr) {
+    result = postRewrite(rewriteSubformulas(f));
+  }
+  rewrittenFormulas[f] = result;
+  return result;
+}
+
+std::shared_ptr<const Term> FormulaRewriter::rewrite(
+    const std::shared_ptr<const Term>& t) {
+  auto it = rewrittenTerms.find(t);
+  if (it != rewrittenTerms.end()) {
+    return it->second;
+  }
+
+  auto result = preRewrite(t);
+  if (result == nullptr) {
+    result = t;
+    if (t->type() == Term::Type::FuncTerm) {
+      auto castedTerm = std::static_pointer_cast<const FuncTerm>(t);
+      std::vector<std::shared_ptr<const Term>> subterms;
+      bool changed = false;
+      for (const auto& subterm : castedTerm->subterms) {
+        subterms.push_back(rewrite(subterm));
+        changed = changed || subterms.back() != subterm;
+      }
+      if (changed) {
+        result = Terms::func(castedTerm->symbol, std::move(subterms));
+      }
+    }
+    result = postRewrite(result);
+  }
+  rewrittenTerms[t] = result;
+  return result;
+}
+
+std::shared_ptr<const Formula> FormulaRewriter::rewriteSubformulas(
+    const std::shared_ptr<const Formula>& f) {
+  // rewrite each element of a vector of subterms or subformulas, and report
+  // whether any element changed
+  auto rewriteAll = [this](const auto& nodes, auto& result) {
+    bool changed = false;
+    for (const auto& node : nodes) {
+      result.push_back(rewrite(node));
+      changed = changed || result.back() != node;
+    }
+    return changed;
+  };
+
+  switch (f->type()) {
+    case Formula::Type::Predicate: {
+      auto castedFormula = std::static_pointer_cast<const PredicateFormula>(f);
+      std::vector<std::shared_ptr<const Term>> subterms;
+      if (rewriteAll(castedFormula->subterms, subterms)) {
+        return Formulas::predicate(castedFormula->symbol, subterms, f->label);
+      }
+      return f;
+    }
+    case Formula::Type::Equality: {
+      auto castedFormula = std::static_pointer_cast<const EqualityFormula>(f);
+      auto left = rewrite(castedFormula->left);
+      auto right = rewrite(castedFormula->right);
+      if (left != castedFormula->left || right != castedFormula->right) {
+        return castedFormula->polarity
+                   ? Formulas::equality(left, right, f->label)
+                   : Formulas::disequality(left, right, f->label);
+      }
+      return f;
+    }
+    case Formula::Type::Conjunction: {
+      auto castedFormula =
+          std::static_pointer_cast<const ConjunctionFormula>(f);
+      std::vector<std::shared_ptr<const Formula>> conj;
+      if (rewriteAll(castedFormula->conj, conj)) {
+        return Formulas::conjunction(conj, f->label);
+      }
+      return f;
+    }
+    case Formula::Type::Disjunction: {
+      auto castedFormula =
+          std::static_pointer_cast<const DisjunctionFormula>(f);
+      std::vector<std::shared_ptr<const Formula>> disj;
+      if (rewriteAll(castedFormula->disj, disj)) {
+        return Formulas::disjunction(disj, f->label);
+      }
+      return f;
+    }
+    case Formula::Type::Negation: {
+      auto castedFormula = std::static_pointer_cast<const NegationFormula>(f);
+      auto subformula = rewrite(castedFormula->f);
+      if (subformula != castedFormula->f) {
+        return Formulas::negation(subformula, f->label);
+      }
+      return f;
+    }
+    case Formula::Type::Existential: {
+      auto castedFormula =
+          std::static_pointer_cast<const ExistentialFormula>(f);
+      auto subformula = rewrite(castedFormula->f);
+      if (subformula != castedFormula->f) {
+        return Formulas::existential(castedFormula->vars, subformula, f->label);
+      }
+      return f;
+    }
+    case Formula::Type::Universal: {
+      auto castedFormula = std::static_pointer_cast<const UniversalFormula>(f);
+      auto subformula = rewrite(castedFormula->f);
+      if (subformula != castedFormula->f) {
+        return Formulas::universal(castedFormula->vars, subformula, f->label);
+      }
+      return f;
+    }
+    case Formula::Type::Implication: {
+      auto castedFormula =
+          std::static_pointer_cast<const ImplicationFormula>(f);
+      auto f1 = rewrite(castedFormula->f1);
+      auto f2 = rewrite(castedFormula->f2);
+      if (f1 != castedFormula->f1 || f2 != castedFormula->f2) {
+        return Formulas::implication(f1, f2, f->label);
+      }
+      return f;
+    }
+    case Formula::Type::Equivalence: {
+      auto castedFormula =
+          std::static_pointer_cast<const EquivalenceFormula>(f);
+      auto f1 = rewrite(castedFormula->f1);
+      auto f2 = rewrite(castedFormula->f2);
+      if (f1 != castedFormula->f1 || f2 != castedFormula->f2) {
+        return Formulas::equivalence(f1, f2, f->label);
+      }
+      return f;
+    }
+    case Formula::Type::True:
+    case Formula::Type::False: {
+      return f;
+    }
+  }
+  assert(false);
+  return f;
+}
+
+}  // namespace logic
@@ -0,0 +1,106 @@
+#ifndef __FormulaVisitor__
+#define __FormulaVisitor__
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Formula.hpp"
+#include "Term.hpp"
+
+namespace logic {
+
+#pragma mark - FormulaVisitor
+
+/*
+ * Base class for passes which traverse formulas and terms.
+ * visit(f) traverses f depth-first and calls the hooks on each formula and each
+ * term. Nodes are memoized by identity: a node which is shared between several
+ * formulas (or occurs several times in a formula) is only visited the first
+ * time, so a pass is linear in the size of the DAG. As a consequence, the hooks
+ * must not depend on the context in which a node occurs. Since nodes are
+ * identified by their address, visited formulas must be kept alive as long as
+ * the visitor is used.
+ */
+class FormulaVisitor {
+ public:
+  virtual ~FormulaVisitor() = default;
+
+  void visit(const Formula& f);
+  void visit(const Term& t);
+
+ protected:
+  // called before the subformulas/subterms of the node are visited.
+  // returning false skips the subformulas/subterms and the post-hook.
+  virtual bool preVisit(const Formula&) { return true; }
+  virtual bool preVisit(const Term&) { return true; }
+  // called after all subformulas/subterms of the node have been visited.
+  virtual void postVisit(const Formula&) {}
+  virtual void postVisit(const Term&) {}
+
+  // ends the traversal as soon as the current hook returns
+  void stop() { stopped = true; }
+  bool isStopped() const { return stopped; }
+
+ private:
+  bool stopped = false;
+  std::unordered_set<const Formula*> visitedFormulas;
+  std::unordered_set<const Term*> visitedTerms;
+};
+
+#pragma mark - FormulaRewriter
+
+/*
+ * Base class for passes which rewrite formulas and terms bottom-up.
+ * rewrite(f) first rewrites the subformulas/subterms of f, then rebuilds f from
+ * the results (using Formulas and Terms, and keeping the label of f) and
+ * finally applies the post-hook to the rebuilt node. If no subformula/subterm
+ * changed, f itself is passed to the post-hook.
+ * As for FormulaVisitor, the results are memoized by node identity, so the
+ * hooks must not depend on the context in which a node occurs.
+ */
+class FormulaRewriter {
+ public:
+  virtual ~FormulaRewriter() = default;
+
+  std::shared_ptr<const Formula> rewrite(
+      const std::shared_ptr<const Formula>& f);
+  std::shared_ptr<const Term> rewrite(const std::shared_ptr<const Term>& t);
+
+ protected:
+  // called before the subformulas/subterms of the node are rewritten.
+  // returning a non-null result replaces the node, without rewriting its
+  // subformulas/subterms and without calling the post-hook.
+  virtual std::shared_ptr<const Formula> preRewrite(
+      const std::shared_ptr<const Formula>&) {
+    return nullptr;
+  }
+  virtual std::shared_ptr<const Term> preRewrite(
+      const std::shared_ptr<const Term>&) {
+    return nullptr;
+  }
+  // called on the node after its subformulas/subterms have been rewritten.
+  virtual std::shared_ptr<const Formula> postRewrite(
+      std::shared_ptr<const Formula> f) {
+    return f;
+  }
+  virtual std::shared_ptr<const Term> postRewrite(
+      std::shared_ptr<const Term> t) {
+    return t;
+  }
+
+ private:
+  // keyed by the original nodes, which are thereby kept alive
+  std::unordered_map<std::shared_ptr<const Formula>,
+                     std::shared_ptr<const Formula>>
+      rewrittenFormulas;
+  std::unordered_map<std::shared_ptr<const Term>, std::shared_ptr<const Term>>
+      rewrittenTerms;
+
+  std::shared_ptr<const Formula> rewriteSubformulas(
+      const std::shared_ptr<const Formula>& f);
+};
+
+}  // namespace logic
+
+#endif
@@ -0,0 +1,547 @@
+#include "Normalizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "Theory.hpp"
+
+namespace logic {
+
+namespace {
+
+// true/false are either the constants or the nullary predicates of Theory
+bool isTrue(const Formula& f) {
+  if (f.type() == Formula::Type::Predicate) {
+    auto& predicate = static_cast<const PredicateFormula&>(f);
+    return predicate.subterms.empty() && predicate.symbol->name == "true";
+  }
+  return f.type() == Formula::Type::True;
+}
+
+bool isFalse(const Formula& f) {
+  if (f.type() == Formula::Type::Predicate) {
+    auto& predicate = static_cast<const PredicateFormula&>(f);
+    return predicate.subterms.empty() && predicate.symbol->name == "false";
+  }
+  return f.type() == Formula::Type::False;
+}
+
+std::shared_ptr<const Formula> withLabel(std::shared_ptr<const Formula> f,
+                                         const std::string& label) {
+  return label.empty() ? f : Formulas::copyWithLabel(f, label);
+}
+
+// if t is an integer constant, stores its value in value and returns true
+bool intValue(const Term& t, long long& value) {
+  if (t.type() != Term::Type::FuncTerm ||
+      t.symbol->rngSort != Sorts::intSort() ||
+      !static_cast<const FuncTerm&>(t).subterms.empty()) {
+    return false;
+  }
+  const auto& name = t.symbol->name;
+  std::size_t start = (name[0] == '-') ? 1 : 0;
+  // longer constants could overflow
+  if (name.size() == start || name.size() - start > 9 ||
+      !std::all_of(name.begin() + start, name.end(), ::isdigit)) {
+    return false;
+  }
+  value = std::stoll(name);
+  return true;
+}
+
+// replaces the free occurrences of a variable by a term
+class Substitution : public FormulaRewriter {
+ public:
+  Substitution(const Symbol& var, std::shared_ptr<const Term> value)
+      : var(var), value(std::move(value)) {}
+
+ protected:
+  std::shared_ptr<const Formula> preRewrite(
+      const std::shared_ptr<const Formula>& f) override {
+    // occurrences below a quantifier rebinding var are not free
+    if (f->type() == Formula::Type::Existential ||
+        f->type() == Formula::Type::Universal) {
+      auto& vars =
+          (f->type() == Formula::Type::Existential)
+              ? static_cast<const ExistentialFormula&>(*f).vars
+              : static_cast<const UniversalFormula&>(*f).vars;
+      for (const auto& v : vars) {
+        if (*v == var) {
+          return f;
+        }
+      }
+    }
+    return nullptr;
+  }
+  std::shared_ptr<const Term> preRewrite(
+      const std::shared_ptr<const Term>& t) override {
+    if (*t->symbol == var) {
+      return value;
+    }
+    return nullptr;
+  }
+
+ private:
+  const Symbol& var;
+  const std::shared_ptr<const Term> value;
+};
+
+// hashing and equality of formulas modulo labels
+struct StructuralHash {
+  std::size_t operator()(const Formula* f) const { return f->hash; }
+};
+struct StructuralEqual {
+  bool operator()(const Formula* f1, const Formula* f2) const {
+    return *f1 == *f2;
+  }
+};
+
+}  // namespace
+
+#pragma mark - Formulas
+
+std::shared_ptr<const Formula> Normalizer::postRewrite(
+    std::shared_ptr<const Formula> f) {
+  switch (f->type()) {
+    case Formula::Type::Predicate: {
+      // fold comparisons of integer constants
+      auto castedFormula = std::static_pointer_cast<const PredicateFormula>(f);
+      long long left, right;
+      if (castedFormula->subterms.size() == 2 &&
+          intValue(*castedFormula->subterms[0], left) &&
+          intValue(*castedFormula->subterms[1], right)) {
+        const auto& name = castedFormula->symbol->name;
+        if (name == "<" || name == "<=" || name == ">" || name == ">=") {
+          bool value = (name == "<")    ? left < right
+                       : (name == "<=") ? left <= right
+                       : (name == ">")  ? left > right
+                                        : left >= right;
+          return value ? Formulas::trueFormula(f->label)
+                       : Formulas::falseFormula(f->label);
+        }
+      }
+      return f;
+    }
+    case Formula::Type::Equality: {
+      auto castedFormula = std::static_pointer_cast<const EqualityFormula>(f);
+      long long left, right;
+      if (*castedFormula->left == *castedFormula->right ||
+          (intValue(*castedFormula->left, left) &&
+           intValue(*castedFormula->right, right))) {
+        // hash-consing ensures that equal constants are the same term
+        bool value = (*castedFormula->left == *castedFormula->right) ==
+                     castedFormula->polarity;
+        return value ? Formulas::trueFormula(f->label)
+                     : Formulas::falseFormula(f->label);
+      }
+      return f;
+    }
+    case Formula::Type::Conjunction:
+    case Formula::Type::Disjunction: {
+      return normalizeJunction(f);
+    }
+    case Formula::Type::Negation: {
+      auto& subformula = static_cast<const NegationFormula&>(*f).f;
+      if (isTrue(*subformula)) {
+        return Formulas::falseFormula(f->label);
+      } else if (isFalse(*subformula)) {
+        return Formulas::trueFormula(f->label);
+      } else if (subformula->type() == Formula::Type::Negation) {
+        return withLabel(static_cast<const NegationFormula&>(*subformula).f,
+                         f->label);
+      }
+      return f;
+    }
+    case Formula::Type::Existential:
+    case Formula::Type::Universal: {
+      return normalizeQuantifier(f);
+    }
+    case Formula::Type::Implication: {
+      auto castedFormula =
+          std::static_pointer_cast<const ImplicationFormula>(f);
+      auto& f1 = castedFormula->f1;
+      auto& f2 = castedFormula->f2;
+      if (isFalse(*f1) || isTrue(*f2) || *f1 == *f2) {
+        return Formulas::trueFormula(f->label);
+      } else if (isTrue(*f1)) {
+        return withLabel(f2, f->label);
+      } else if (isFalse(*f2)) {
+        return postRewrite(Formulas::negation(f1, f->label));
+      }
+      return f;
+    }
+    case Formula::Type::Equivalence: {
+      auto castedFormula =
+          std::static_pointer_cast<const EquivalenceFormula>(f);
+      auto& f1 = castedFormula->f1;
+      auto& f2 = castedFormula->f2;
+      if (*f1 == *f2) {
+        return Formulas::trueFormula(f->label);
+      } else if (isTrue(*f1)) {
+        return withLabel(f2, f->label);
+      } else if (isTrue(*f2)) {
+        return withLabel(f1, f->label);
+      } else if (isFalse(*f1)) {
+        return postRewrite(Formulas::negation(f2, f->label));
+      } else if (isFalse(*f2)) {
+        return postRewrite(Formulas::negation(f1, f->label));
+      }
+      return f;
+    }
+    case Formula::Type::True:
+    case Formula::Type::False: {
+      return f;
+    }
+  }
+  assert(false);
+  return f;
+}
+
+std::shared_ptr<const Formula> Normalizer::normalizeJunction(
+    std::shared_ptr<const Formula> f) {
+  bool isConjunction = f->type() == Formula::Type::Conjunction;
+  auto subformulas = [isConjunction](const Formula& g) -> const auto& {
+    return isConjunction ? static_cast<const ConjunctionFormula&>(g).conj
+                         : static_cast<const DisjunctionFormula&>(g).disj;
+  };
+
+  std::vector<std::shared_ptr<const Formula>> result;
+  std::unordered_set<const Formula*, StructuralHash, StructuralEqual> seen;
+  bool changed = false;
+  // whether some element is false (for conjunctions) or true (otherwise)
+  bool absorbed = false;
+
+  auto add = [&](const std::shared_ptr<const Formula>& g) {
+    if (isConjunction ? isTrue(*g) : isFalse(*g)) {
+      changed = true;
+    } else if (isConjunction ? isFalse(*g) : isTrue(*g)) {
+      absorbed = true;
+    } else if (!seen.insert(g.get()).second) {
+      changed = true;
+    } else {
+      result.push_back(g);
+    }
+  };
+  for (const auto& g : subformulas(*f)) {
+    // the subformulas are already normalized, so nested junctions are flat
+    if (g->type() == f->type() && g->label.empty()) {
+      changed = true;
+      for (const auto& h : subformulas(*g)) {
+        add(h);
+      }
+    } else {
+      add(g);
+    }
+  }
+
+  // g together with (not g)
+  for (const auto& g : result) {
+    if (g->type() == Formula::Type::Negation &&
+        seen.count(static_cast<const NegationFormula&>(*g).f.get()) > 0) {
+      absorbed = true;
+    }
+  }
+
+  if (absorbed) {
+    return isConjunction ? Formulas::falseFormula(f->label)
+                         : Formulas::trueFormula(f->label);
+  }
+  if (!changed && result.size() > 1) {
+    return f;
+  }
+  return isConjunction ? Formulas::conjunctionSimp(result, f->label)
+                       : Formulas::disjunctionSimp(result, f->label);
+}
+
+std::shared_ptr<const Formula> Normalizer::normalizeQuantifier(
+    std::shared_ptr<const Formula> f) {
+  bool isExistential = f->type() == Formula::Type::Existential;
+  auto& vars = isExistential ? static_cast<const ExistentialFormula&>(*f).vars
+                             : static_cast<const UniversalFormula&>(*f).vars;
+  auto& body = isExistential ? static_cast<const ExistentialFormula&>(*f).f
+                             : static_cast<const UniversalFormula&>(*f).f;
+
+  if (isTrue(*body)) {
+    return Formulas::trueFormula(f->label);
+  } else if (isFalse(*body)) {
+    return Formulas::falseFormula(f->label);
+  }
+
+  // drop the variables which don't occur in the body. Occurrences below a
+  // quantifier rebinding the variable are counted too, which is harmless.
+  const auto& bodySymbols = symbols(body);
+  std::vector<std::shared_ptr<const Symbol>> usedVars;
+  for (const auto& var : vars) {
+    if (bodySymbols.occurring.count(var->id) > 0) {
+      usedVars.push_back(var);
+    }
+  }
+  if (usedVars.empty()) {
+    return withLabel(body, f->label);
+  }
+
+  auto result = applyOnePointRule(isExistential, usedVars, body, f->label,
+                                  bodySymbols.bound);
+  if (result != nullptr) {
+    return result;
+  }
+
+  if (usedVars.size() < vars.size()) {
+    return isExistential ? Formulas::existential(usedVars, body, f->label)
+                         : Formulas::universal(usedVars, body, f->label);
+  }
+  return f;
+}
+
+std::shared_ptr<const Formula> Normalizer::applyOnePointRule(
+    bool isExistential, const std::vector<std::shared_ptr<const Symbol>>& vars,
+    const std::shared_ptr<const Formula>& body, const std::string& label,
+    const std::unordered_set<unsigned>& boundVars) {
+  std::shared_ptr<const Symbol> var;
+  std::shared_ptr<const Term> value;
+
+  // checks whether g is an equality x = e or e = x (or its negation, if
+  // negated is set), where x is one of vars and e contains neither x nor
+  // variables bound inside the body. If so, stores x in var and e in value.
+  auto isDefinition = [&](const Formula& g, bool negated) {
+    auto h = &g;
+    if (negated && g.type() == Formula::Type::Negation) {
+      h = static_cast<const NegationFormula&>(g).f.get();
+      negated = false;
+    }
+    if (h->type() != Formula::Type::Equality ||
+        static_cast<const EqualityFormula&>(*h).polarity == negated) {
+      return false;
+    }
+    auto& eq = static_cast<const EqualityFormula&>(*h);
+    for (const auto& sides : {std::make_pair(eq.left, eq.right),
+                              std::make_pair(eq.right, eq.left)}) {
+      auto it = std::find_if(vars.begin(), vars.end(), [&](const auto& v) {
+        return *v == *sides.first->symbol;
+      });
+      if (it == vars.end()) {
+        continue;
+      }
+      const auto& occurring = symbols(sides.second).occurring;
+      if (occurring.count((*it)->id) > 0 ||
+          std::any_of(occurring.begin(), occurring.end(),
+                      [&](unsigned id) { return boundVars.count(id) > 0; })) {
+        continue;
+      }
+      var = *it;
+      value = sides.second;
+      return true;
+    }
+    return false;
+  };
+  // stores the elements of subformulas except the first definition in rest,
+  // and returns whether there is a definition
+  auto removeDefinition =
+      [&](const std::vector<std::shared_ptr<const Formula>>& subformulas,
+          bool negated, std::vector<std::shared_ptr<const Formula>>& rest) {
+        auto it = std::find_if(
+            subformulas.begin(), subformulas.end(),
+            [&](const auto& g) { return isDefinition(*g, negated); });
+        if (it == subformulas.end()) {
+          return false;
+        }
+        rest.assign(subformulas.begin(), it);
+        rest.insert(rest.end(), it + 1, subformulas.end());
+        return true;
+      };
+
+  // the body after removing the definition
+  std::shared_ptr<const Formula> rest;
+  std::vector<std::shared_ptr<const Formula>> subformulas;
+  if (isExistential) {
+    // exists x. (x = e & F)
+    if (isDefinition(*body, false)) {
+      rest = Formulas::trueFormula(body->label);
+    } else if (body->type() == Formula::Type::Conjunction &&
+               removeDefinition(
+                   static_cast<const ConjunctionFormula&>(*body).conj, false,
+                   subformulas)) {
+      rest = Formulas::conjunctionSimp(subformulas, body->label);
+    }
+  } else if (body->type() == Formula::Type::Implication) {
+    // forall x. ((x = e & G) => F)
+    auto& implication = static_cast<const ImplicationFormula&>(*body);
+    auto& premise = implication.f1;
+    std::shared_ptr<const Formula> premiseRest;
+    if (isDefinition(*premise, false)) {
+      premiseRest = Formulas::trueFormula();
+    } else if (premise->type() == Formula::Type::Conjunction &&
+               removeDefinition(
+                   static_cast<const ConjunctionFormula&>(*premise).conj,
+                   false, subformulas)) {
+      premiseRest = Formulas::conjunctionSimp(subformulas, premise->label);
+    }
+    if (premiseRest != nullptr) {
+      rest = Formulas::implicationSimp(premiseRest, implication.f2,
+                                       body->label);
+    }
+  } else if (body->type() == Formula::Type::Disjunction &&
+             removeDefinition(
+                 static_cast<const DisjunctionFormula&>(*body).disj, true,
+                 subformulas)) {
+    // forall x. (x != e | F)
+    rest = Formulas::disjunctionSimp(subformulas, body->label);
+  }
+  if (rest == nullptr) {
+    return nullptr;
+  }
+
+  Substitution substitution(*var, value);
+  auto substituted = substitution.rewrite(rest);
+  std::vector<std::shared_ptr<const Symbol>> remainingVars;
+  for (const auto& v : vars) {
+    if (v != var) {
+      remainingVars.push_back(v);
+    }
+  }
+  // the substitution may enable further simplifications
+  return rewrite(
+      isExistential
+          ? Formulas::existentialSimp(remainingVars, substituted, label)
+          : Formulas::universalSimp(remainingVars, substituted, label));
+}
+
+#pragma mark - Symbols
+
+const Normalizer::Symbols& Normalizer::symbols(
+    const std::shared_ptr<const Formula>& f) {
+  auto it = formulaSymbols.find(f);
+  if (it != formulaSymbols.end()) {
+    return it->second;
+  }
+
+  Symbols result;
+  auto add = [&result](const Symbols& s) {
+    result.occurring.insert(s.occurring.begin(), s.occurring.end());
+    result.bound.insert(s.bound.begin(), s.bound.end());
+  };
+  switch (f->type()) {
+    case Formula::Type::Predicate: {
+      for (const auto& subterm :
+           static_cast<const PredicateFormula&>(*f).subterms) {
+        add(symbols(subterm));
+      }
+      break;
+    }
+    case Formula::Type::Equality: {
+      auto& castedFormula = static_cast<const EqualityFormula&>(*f);
+      add(symbols(castedFormula.left));
+      add(symbols(castedFormula.right));
+      break;
+    }
+    case Formula::Type::Conjunction: {
+      for (const auto& conjunct :
+           static_cast<const ConjunctionFormula&>(*f).conj) {
+        add(symbols(conjunct));
+      }
+      break;
+    }
+    case Formula::Type::Disjunction: {
+      for (const auto& disjunct :
+           static_cast<const DisjunctionFormula&>(*f).disj) {
+        add(symbols(disjunct));
+      }
+      break;
+    }
+    case Formula::Type::Negation: {
+      add(symbols(static_cast<const NegationFormula&>(*f).f));
+      break;
+    }
+    case Formula::Type::Existential:
+    case Formula::Type::Universal: {
+      bool isExistential = f->type() == Formula::Type::Existential;
+      auto& vars = isExistential
+                       ? static_cast<const ExistentialFormula&>(*f).vars
+                       : static_cast<const UniversalFormula&>(*f).vars;
+      add(symbols(isExistential ? static_cast<const ExistentialFormula&>(*f).f
+                                : static_cast<const UniversalFormula&>(*f).f));
+      for (const auto& var : vars) {
+        result.bound.insert(var->id);
+      }
+      break;
+    }
+    case Formula::Type::Implication: {
+      auto& castedFormula = static_cast<const ImplicationFormula&>(*f);
+      add(symbols(castedFormula.f1));
+      add(symbols(castedFormula.f2));
+      break;
+    }
+    case Formula::Type::Equivalence: {
+      auto& castedFormula = static_cast<const EquivalenceFormula&>(*f);
+      add(symbols(castedFormula.f1));
+      add(symbols(castedFormula.f2));
+      break;
+    }
+    case Formula::Type::True:
+    case Formula::Type::False: {
+      break;
+    }
+  }
+  return formulaSymbols.emplace(f, std::move(result)).first->second;
+}
+
+const Normalizer::Symbols& Normalizer::symbols(
+    const std::shared_ptr<const Term>& t) {
+  auto it = termSymbols.find(t);
+  if (it != termSymbols.end()) {
+    return it->second;
+  }
+
+  Symbols result;
+  result.occurring.insert(t->symbol->id);
+  if (t->type() == Term::Type::FuncTerm) {
+    for (const auto& subterm : static_cast<const FuncTerm&>(*t).subterms) {
+      const auto& s = symbols(subterm);
+      result.occurring.insert(s.occurring.begin(), s.occurring.end());
+    }
+  }
+  return termSymbols.emplace(t, std::move(result)).first->second;
+}
+
+#pragma mark - Terms
+
+std::shared_ptr<const Term> Normalizer::postRewrite(
+    std::shared_ptr<const Term> t) {
+  // fold arithmetic on integer constants, if the result doesn't overflow
+  if (t->type() != Term::Type::FuncTerm) {
+    return t;
+  }
+  auto castedTerm = std::static_pointer_cast<const FuncTerm>(t);
+  long long left, right;
+  if (castedTerm->subterms.size() != 2 ||
+      !intValue(*castedTerm->subterms[0], left) ||
+      !intValue(*castedTerm->subterms[1], right)) {
+    return t;
+  }
+
+  const auto& name = castedTerm->symbol->name;
+  long long value;
+  if (name == "+") {
+    value = left + right;
+  } else if (name == "-") {
+    value = left - right;
+  } else if (name == "*") {
+    value = left * right;
+  } else {
+    return t;
+  }
+  if (value < std::numeric_limits<int>::min() ||
+      value > std::numeric_limits<int>::max()) {
+    return t;
+  }
+  return Theory::intConstant(static_cast<int>(value));
+}
+
+}  // namespace logic
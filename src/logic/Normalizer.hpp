@@ -0,0 +1,71 @@
+#ifndef __Normalizer__
+#define __Normalizer__
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Formula.hpp"
+#include "FormulaVisitor.hpp"
+#include "Term.hpp"
+
+namespace logic {
+
+/*
+ * Simplifies formulas before they are output:
+ * - flattens nested conjunctions and disjunctions (unless the nested one is
+ *   labeled, so that its comment is kept), and removes true, false, duplicate
+ *   and complementary conjuncts/disjuncts
+ * - removes double negations and trivial implications and equivalences
+ * - applies the one-point rule, i.e. rewrites forall x. (x = e => F) to
+ *   F[x := e] and exists x. (x = e & F) to F[x := e]
+ * - drops quantified variables which don't occur in the body
+ * - folds ground integer arithmetic and comparisons
+ * The result is equivalent to the input. Since the results are memoized by
+ * FormulaRewriter, shared subformulas are only normalized once. Likewise, the
+ * symbols occurring in a node are computed once from those of its children.
+ */
+class Normalizer : public FormulaRewriter {
+ protected:
+  std::shared_ptr<const Formula> postRewrite(
+      std::shared_ptr<const Formula> f) override;
+  std::shared_ptr<const Term> postRewrite(
+      std::shared_ptr<const Term> t) override;
+
+ private:
+  // the ids of the symbols occurring in a formula or term, and of the
+  // variables bound by quantifiers inside it. Occurrences of a quantified
+  // variable are either LVariables or (as built by the parser) nullary
+  // FuncTerms over the variable symbol, so the symbols of all terms are
+  // collected.
+  struct Symbols {
+    std::unordered_set<unsigned> occurring;
+    std::unordered_set<unsigned> bound;
+  };
+  // memoized by node, which are thereby kept alive
+  std::unordered_map<std::shared_ptr<const Formula>, Symbols> formulaSymbols;
+  std::unordered_map<std::shared_ptr<const Term>, Symbols> termSymbols;
+
+  const Symbols& symbols(const std::shared_ptr<const Formula>& f);
+  const Symbols& symbols(const std::shared_ptr<const Term>& t);
+
+  std::shared_ptr<const Formula> normalizeJunction(
+      std::shared_ptr<const Formula> f);
+  std::shared_ptr<const Formula> normalizeQuantifier(
+      std::shared_ptr<const Formula> f);
+  // applies the one-point rule to the quantified formula with the given
+  // variables, body and label. boundVars contains the ids of the variables
+  // bound by quantifiers inside the body, which must not capture the
+  // substituted term. Returns nullptr if the rule is not applicable.
+  std::shared_ptr<const Formula> applyOnePointRule(
+      bool isExistential,
+      const std::vector<std::shared_ptr<const Symbol>>& vars,
+      const std::shared_ptr<const Formula>& body, const std::string& label,
+      const std::unordered_set<unsigned>& boundVars);
+};
+
+}  // namespace logic
+
+#endif
@@ -1,11 +1,28 @@
 #include "Problem.hpp"
 
 #include <algorithm>
+#include <condition_variable>
+#include <cstdint>
 #include <ctime>
+#include <exception>
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
+#include "Context.hpp"
+#include "FormulaVisitor.hpp"
+#include "Normalizer.hpp"
 #include "Options.hpp"
 #include "Output.hpp"
+#include "SharingWriter.hpp"
+#include "TaskArchive.hpp"
 
 namespace logic {
 
@@ -16,16 +33,17 @@ std::ostream& operator<<(
   return ostr;
 }
 
-void ReasoningTask::outputSMTLIBToDir(std::string dirPath,
-                                      std::string preamble) const {
+bool ReasoningTask::outputSMTLIBToDir(const std::string& dirPath,
+                                      const std::string& preamble) const {
   auto outfileName = dirPath + conjecture->name + ".smt2";
   if (std::ifstream(outfileName)) {
-    std::cout << "Error: The output-file " << outfileName << " already exists!"
-              << std::endl;
-    exit(1);
+    std::cout << ("Error: The output-file " + outfileName +
+                  " already exists!\n");
+    return false;
   }
 
-  std::cout << "Generating reasoning task in " << outfileName << "\n";
+  // a single write, so that messages of concurrent tasks don't interleave
+  std::cout << ("Generating reasoning task in " + outfileName + "\n");
   std::ofstream outfile(outfileName);
 
   if (!util::Configuration::instance().generateBenchmark()) {
@@ -34,24 +52,169 @@ void ReasoningTask::outputSMTLIBToDir(std::string dirPath,
 
   // output task
   outputSMTLIB(outfile);
+  outfile.close();
+  if (!outfile) {
+    std::cout << ("Error: Unable to write the output-file " + outfileName +
+                  "\n");
+    return false;
+  }
+  return true;
 }
 
-void ReasoningTask::outputSMTLIB(std::ostream& ostr) const {
+namespace {
+
+// whether the file consists of exactly the given content
+bool hasContent(const std::filesystem::path& file, const std::string& content) {
+  std::error_code error;
+  if (std::filesystem::file_size(file, error) != content.size() || error) {
+    return false;
+  }
+  std::ifstream in(file, std::ios::binary);
+  std::stringstream fileContent;
+  fileContent << in.rdbuf();
+  return in && fileContent.str() == content;
+}
+
+}  // namespace
+
+bool ReasoningTask::outputSMTLIBToCache(const std::string& dirPath,
+                                        const std::string& preamble,
+                                        const std::string& cacheDir,
+                                        std::string& hash) const {
+  std::stringstream task;
+  outputSMTLIB(task);
+  auto content = task.str();
+
+  // 64-bit FNV-1a, which is stable across runs and platforms
+  std::uint64_t value = 14695981039346656037ull;
+  for (auto c : content) {
+    value = (value ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  }
+  std::stringstream hex;
+  hex << std::hex << std::setw(16) << std::setfill('0') << value;
+  hash = hex.str();
+
+  // the cached file doesn't contain the preamble, since the same task can be
+  // generated from different programs. Since the hash doesn't identify the
+  // content, a cached file is only reused if its content is the same, and
+  // tasks with colliding hashes are stored as <hash>-1, <hash>-2, etc.
+  std::filesystem::create_directories(cacheDir);
+  std::filesystem::path cachedFile;
+  bool isNew = false;
+  for (unsigned i = 0;; ++i) {
+    auto name = (i == 0) ? hash : hash + "-" + std::to_string(i);
+    cachedFile = std::filesystem::path(cacheDir) / (name + ".smt2");
+    if (!std::filesystem::exists(cachedFile)) {
+      // write to a temporary file first, so that the cached file is never
+      // incomplete. Linking the temporary file fails if another writer has
+      // stored a task under the same name in the meantime, which is then
+      // compared like any other cached file.
+      std::stringstream temporaryName;
+      temporaryName << "." << conjecture->name << "."
+                    << std::this_thread::get_id() << ".tmp";
+      auto temporaryFile = cachedFile;
+      temporaryFile += temporaryName.str();
+      std::ofstream temporary(temporaryFile, std::ios::binary);
+      temporary << content;
+      temporary.close();
+      if (!temporary) {
+        throw std::filesystem::filesystem_error(
+            "Unable to write the cached task", temporaryFile,
+            std::make_error_code(std::errc::io_error));
+      }
+      // the output-files are hard links to the cached file, which must not be
+      // changed through them
+      std::filesystem::permissions(temporaryFile,
+                                   std::filesystem::perms::owner_read |
+                                       std::filesystem::perms::group_read |
+                                       std::filesystem::perms::others_read);
+      std::error_code error;
+      std::filesystem::create_hard_link(temporaryFile, cachedFile, error);
+      if (error && !std::filesystem::exists(cachedFile)) {
+        // e.g. if the file system doesn't support hard links
+        std::filesystem::rename(temporaryFile, cachedFile);
+        error.clear();
+      }
+      std::filesystem::remove(temporaryFile);
+      if (!error) {
+        isNew = true;
+        hash = name;
+        break;
+      }
+    }
+    if (hasContent(cachedFile, content)) {
+      hash = name;
+      break;
+    }
+  }
+
+  auto outfileName = dirPath + conjecture->name + ".smt2";
+  std::cout << ((isNew ? "Generating reasoning task in "
+                       : "Reusing reasoning task in ") +
+                outfileName + "\n");
+  std::filesystem::remove(outfileName);
+  if (util::Configuration::instance().generateBenchmark() ||
+      preamble.empty()) {
+    std::error_code error;
+    std::filesystem::create_hard_link(cachedFile, outfileName, error);
+    if (error) {
+      // e.g. if the cache is on a different file system
+      std::filesystem::copy_file(cachedFile, outfileName);
+      std::filesystem::permissions(outfileName,
+                                   std::filesystem::perms::owner_write,
+                                   std::filesystem::perm_options::add);
+    }
+  } else {
+    std::ofstream(outfileName) << preamble << content;
+  }
+  return isNew;
+}
+
+std::size_t ReasoningTask::outputSMTLIBToArchive(
+    TaskArchive& archive, const std::string& preamble) const {
+  std::stringstream task;
+  if (!util::Configuration::instance().generateBenchmark()) {
+    task << preamble;
+  }
+  outputSMTLIB(task);
+  auto content = task.str();
+  archive.add(conjecture->name + ".smt2", content);
+  return content.size();
+}
+
+namespace {
+
+void writeFormula(std::ostream& ostr, const Formula& f, unsigned indentation,
+                  bool letBindings) {
+  if (letBindings) {
+    SharingWriter::writeSMTLIB(ostr, f, indentation);
+  } else {
+    f.writeSMTLIB(ostr, indentation);
+  }
+}
+
+// outputs the logic, and the meta information if the encoding is used as
+// smtlib-benchmark
+void writeLogic(std::ostream& ostr) {
   auto smtlibLogic = "UFDTLIA";  // uninterpreted functions, datatypes and
                                  // linear integer arithmetic
 
-  // if encoding is used as smtlib-benchmark, add meta information
   if (util::Configuration::instance().generateBenchmark()) {
     ostr << "(set-info :smt-lib-version 2.6)\n";
     ostr << "(set-logic " << smtlibLogic << ")\n";
 
-    std::time_t t = std::time(0);
-    std::tm* now = std::localtime(&t);
+    // computed once, since localtime is not thread-safe
+    static const std::string date = [] {
+      std::time_t t = std::time(0);
+      std::tm* now = std::localtime(&t);
+      return std::to_string(now->tm_year + 1900) + "-" +
+             std::to_string(now->tm_mon + 1) + "-" +
+             std::to_string(now->tm_mday);
+    }();
 
     ostr << "(set-info :source |\n"
          << "Generated by: Bernhard Gleiss\n"
-         << "Generated on: " << (now->tm_year + 1900) << "-"
-         << (now->tm_mon + 1) << "-" << now->tm_mday << "\n"
+         << "Generated on: " << date << "\n"
          << "Generator: Rapid\n"
          << "Application: Software Verification\n"
          << "Target solver: Vampire\n"
@@ -63,112 +226,787 @@ void ReasoningTask::outputSMTLIB(std::ostream& ostr) const {
   } else {
     ostr << "\n(set-logic " << smtlibLogic << ")\n\n";
   }
+}
 
-  // output sort declarations
-  for (const auto& pair : Sorts::nameToSort()) {
-    ostr << declareSortSMTLIB(*pair.second);
+// outputs (assert (not F)), which is used instead of (assert-not F) by
+// smtlib-benchmarks and by incremental scripts
+void writeNegatedConjecture(std::ostream& ostr, const ProblemItem& conjecture,
+                            bool letBindings) {
+  ostr << "\n; negated conjecture\n"
+       << "(assert\n"
+       << "   (not\n";
+  writeFormula(ostr, *conjecture.formula, 6, letBindings);
+  ostr << "\n"
+       << "   )\n"
+       << ")\n";
+}
+
+// collects the symbols occurring in formulas, including quantified variables
+class SymbolCollector : public FormulaVisitor {
+ public:
+  std::vector<const Symbol*> symbols;
+
+ protected:
+  bool preVisit(const Formula& f) override {
+    if (f.type() == Formula::Type::Predicate) {
+      add(*static_cast<const PredicateFormula&>(f).symbol);
+    } else if (f.type() == Formula::Type::Existential ||
+               f.type() == Formula::Type::Universal) {
+      auto& vars = (f.type() == Formula::Type::Existential)
+                       ? static_cast<const ExistentialFormula&>(f).vars
+                       : static_cast<const UniversalFormula&>(f).vars;
+      for (const auto& var : vars) {
+        add(*var);
+      }
+    }
+    return true;
+  }
+  bool preVisit(const Term& t) override {
+    add(*t.symbol);
+    return true;
   }
 
-  // output symbol definitions
+ private:
+  std::unordered_set<const Symbol*> collected;
+
+  void add(const Symbol& symbol) {
+    if (collected.insert(&symbol).second) {
+      symbols.push_back(&symbol);
+    }
+  }
+};
+
+// outputs s as JSON string
+void writeJSONString(std::ostream& ostr, const std::string& s) {
+  ostr << "\"";
+  for (auto c : s) {
+    if (c == '"' || c == '\\') {
+      ostr << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      ostr << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+           << static_cast<int>(c) << std::dec;
+    } else {
+      ostr << c;
+    }
+  }
+  ostr << "\"";
+}
+
+// the line of tasks.jsonl for the task, whose file has the given size
+std::string manifestEntry(const ReasoningTask& task, std::uintmax_t bytes) {
+  auto& log = *task.log;
+  auto& item = log.item(task.prefixLength);
+  std::stringstream entry;
+  entry << "{\"task\":";
+  writeJSONString(entry, task.conjecture->name + ".smt2");
+  entry << ",\"type\":\""
+        << (item.type == ProblemItem::Type::Lemma ? "lemma" : "conjecture")
+        << "\",\"dependencies\":[";
+
+  // the task depends on the tasks proving the lemmas used as axioms
+  std::size_t numberOfAxioms = 0;
+  std::size_t numberOfDependencies = 0;
+  for (std::size_t i = 0; i < task.prefixLength; ++i) {
+    if (task.isAxiom(i)) {
+      if (log.item(i).type == ProblemItem::Type::Lemma) {
+        entry << (numberOfDependencies++ > 0 ? "," : "");
+        writeJSONString(entry, log.item(i).name + ".smt2");
+      }
+      numberOfAxioms++;
+    }
+  }
+
+  std::unordered_set<const Symbol*> symbols;
+  task.collectSymbols(symbols);
+  auto numberOfSymbols =
+      std::count_if(symbols.begin(), symbols.end(),
+                    [](const auto& symbol) { return !symbol->noDeclaration; });
+
+  entry << "],\"axioms\":" << numberOfAxioms << ",\"bytes\":" << bytes
+        << ",\"symbols\":" << numberOfSymbols << "}\n";
+  return entry.str();
+}
+
+}  // namespace
+
+#pragma mark - AxiomLog
+
+void AxiomLog::append(std::shared_ptr<const ProblemItem> item) {
+  std::shared_ptr<const ProblemItem> axiom;
+  if (item->type == ProblemItem::Type::Axiom ||
+      item->type == ProblemItem::Type::Definition) {
+    axiom = item;
+  } else if (item->type == ProblemItem::Type::Lemma) {
+    axiom = std::make_shared<Axiom>(item->formula,
+                                    "already-proven-lemma " + item->name);
+  }
+  auto index = items.size();
+  auto visibility = static_cast<std::size_t>(item->visibility);
+  indicesByName[item->name].push_back(index);
+  bool isAxiom = axiom != nullptr;
+  items.push_back(std::move(item));
+  axioms.push_back(std::move(axiom));
+  caches.emplace_back();
+
+  if (indexSymbols && isAxiom) {
+    bool hasSymbols = false;
+    for (const auto& symbol : symbols(index)) {
+      if (!symbol->noDeclaration) {
+        symbolOccurrences[symbol][visibility].push_back(index);
+        hasSymbols = true;
+      }
+    }
+    if (!hasSymbols) {
+      withoutSymbols[visibility].push_back(index);
+    }
+  }
+}
+
+const std::vector<std::size_t>& AxiomLog::occurrences(
+    const Symbol* symbol, ProblemItem::Visibility visibility) const {
+  assert(indexSymbols);
+  static const std::vector<std::size_t> none;
+  auto it = symbolOccurrences.find(symbol);
+  return it == symbolOccurrences.end()
+             ? none
+             : it->second[static_cast<std::size_t>(visibility)];
+}
+
+const std::vector<std::size_t>& AxiomLog::itemsWithoutSymbols(
+    ProblemItem::Visibility visibility) const {
+  assert(indexSymbols);
+  return withoutSymbols[static_cast<std::size_t>(visibility)];
+}
+
+const std::vector<std::size_t>& AxiomLog::indices(
+    const std::string& name) const {
+  static const std::vector<std::size_t> none;
+  auto it = indicesByName.find(name);
+  return it == indicesByName.end() ? none : it->second;
+}
+
+std::string AxiomLog::declarationsSMTLIB() const {
+  std::lock_guard<std::mutex> lock(declarationsMutex);
+  auto sorts = Sorts::usedSorts();
+  auto& symbols = Signature::signatureOrderedByInsertion();
+  std::pair<std::size_t, std::size_t> size(sorts.size(), symbols.size());
+  if (renderedDeclarations.empty() || declarationsSize != size) {
+    std::string declarations;
+    for (const auto& sort : sorts) {
+      declarations += declareSortSMTLIB(*sort);
+    }
+    for (const auto& symbol : symbols) {
+      declarations += symbol->declareSymbolSMTLIB();
+    }
+    renderedDeclarations = std::move(declarations);
+    declarationsSize = size;
+  }
+  return renderedDeclarations;
+}
+
+const std::string& AxiomLog::axiomSMTLIB(std::size_t i) const {
+  assert(axioms[i] != nullptr);
+  auto& cache = caches[i];
+  std::call_once(cache.rendered, [&] {
+    auto& axiom = *axioms[i];
+    assert(axiom.type == ProblemItem::Type::Axiom ||
+           axiom.type == ProblemItem::Type::Definition);
+    std::stringstream ostr;
+    if (axiom.name != "") {
+      ostr << "\n; "
+           << (axiom.type == ProblemItem::Type::Axiom ? "Axiom: "
+                                                      : "Definition: ")
+           << axiom.name;
+    }
+    ostr << "\n(assert\n";
+    writeFormula(ostr, *axiom.formula, 3,
+                 util::Configuration::instance().letBindings());
+    ostr << "\n)\n";
+    cache.axiomSMTLIB = ostr.str();
+  });
+  return cache.axiomSMTLIB;
+}
+
+const std::vector<const Symbol*>& AxiomLog::symbols(std::size_t i) const {
+  auto& cache = caches[i];
+  std::call_once(cache.collected, [&] {
+    SymbolCollector collector;
+    collector.visit(*items[i]->formula);
+    cache.symbols = std::move(collector.symbols);
+  });
+  return cache.symbols;
+}
+
+void AxiomLog::writeDeclarationsSMTLIB(
+    std::ostream& ostr, const std::unordered_set<const Symbol*>& symbols) {
+  std::unordered_set<const Sort*> sorts;
+  for (const auto& symbol : symbols) {
+    sorts.insert(symbol->rngSort);
+    sorts.insert(symbol->argSorts.begin(), symbol->argSorts.end());
+  }
+  for (const auto& sort : Sorts::usedSorts()) {
+    if (sorts.count(sort) > 0) {
+      ostr << declareSortSMTLIB(*sort);
+    }
+  }
   for (const auto& symbol : Signature::signatureOrderedByInsertion()) {
-    ostr << symbol->declareSymbolSMTLIB();
+    if (symbols.count(symbol.get()) > 0) {
+      ostr << symbol->declareSymbolSMTLIB();
+    }
+  }
+}
+
+#pragma mark - ReasoningTask
+
+bool ReasoningTask::isAxiom(std::size_t i) const {
+  return isVisible(i) && (selection.empty() || selection[i]);
+}
+
+bool ReasoningTask::isVisible(std::size_t i) const {
+  assert(i < prefixLength);
+  if (log->axiom(i) == nullptr) {
+    return false;
+  }
+
+  auto& curr = log->item(i);
+  auto& fromItems = log->item(prefixLength).fromItems;
+  if (fromItems.empty()) {
+    // implicit mode: all axioms visible for implicit mode
+    return curr.visibility == ProblemItem::Visibility::All ||
+           curr.visibility == ProblemItem::Visibility::Implicit;
+  }
+  // explicit mode: all axioms, which are either visible for explicit mode or
+  // occur in fromItems
+  return curr.visibility == ProblemItem::Visibility::All ||
+         std::find(fromItems.begin(), fromItems.end(), curr.name) !=
+             fromItems.end();
+}
+
+std::vector<bool> ReasoningTask::selectAxiomsSInE(double tolerance,
+                                                  unsigned depth) const {
+  // interpreted symbols and variables say nothing about relevance
+  auto isUninterpreted = [](const Symbol* symbol) {
+    return !symbol->noDeclaration;
+  };
+
+  // the visible items are the visible ones of the indexed visibilities, and
+  // (in explicit mode) the items referenced in fromItems, which are always
+  // selected
+  std::vector<bool> result(prefixLength, false);
+  std::vector<ProblemItem::Visibility> visibilities = {
+      ProblemItem::Visibility::All};
+  std::vector<std::size_t> hiddenReferenced;
+  auto& fromItems = log->item(prefixLength).fromItems;
+  if (fromItems.empty()) {
+    visibilities.push_back(ProblemItem::Visibility::Implicit);
+  }
+  for (const auto& name : fromItems) {
+    for (const auto& i : log->indices(name)) {
+      if (i < prefixLength && isVisible(i) && !result[i]) {
+        result[i] = true;
+        if (log->item(i).visibility != ProblemItem::Visibility::All) {
+          hiddenReferenced.push_back(i);
+        }
+      }
+    }
+  }
+  for (const auto& visibility : visibilities) {
+    for (const auto& i : log->itemsWithoutSymbols(visibility)) {
+      if (i >= prefixLength) {
+        break;
+      }
+      result[i] = true;
+    }
+  }
+
+  // calls f on each visible item in which the symbol occurs
+  auto forEachOccurrence = [&](const Symbol* symbol, auto f) {
+    for (const auto& visibility : visibilities) {
+      for (const auto& i : log->occurrences(symbol, visibility)) {
+        if (i >= prefixLength) {
+          break;
+        }
+        f(i);
+      }
+    }
+    for (const auto& i : hiddenReferenced) {
+      auto& symbols = log->symbols(i);
+      if (std::find(symbols.begin(), symbols.end(), symbol) != symbols.end()) {
+        f(i);
+      }
+    }
+  };
+
+  // the number of visible items each symbol occurs in, and the least such
+  // number among the symbols of each item, computed when first needed
+  std::unordered_map<const Symbol*, unsigned> occurrences;
+  auto numberOfOccurrences = [&](const Symbol* symbol) {
+    auto it = occurrences.find(symbol);
+    if (it != occurrences.end()) {
+      return it->second;
+    }
+    unsigned count = 0;
+    forEachOccurrence(symbol, [&](std::size_t) { ++count; });
+    occurrences[symbol] = count;
+    return count;
+  };
+  std::unordered_map<std::size_t, unsigned> minOccurrences;
+  auto leastOccurrences = [&](std::size_t i) {
+    auto it = minOccurrences.find(i);
+    if (it != minOccurrences.end()) {
+      return it->second;
+    }
+    auto least = std::numeric_limits<unsigned>::max();
+    for (const auto& symbol : log->symbols(i)) {
+      if (isUninterpreted(symbol)) {
+        least = std::min(least, numberOfOccurrences(symbol));
+      }
+    }
+    minOccurrences[i] = least;
+    return least;
+  };
+
+  // select the triggered items round by round, starting from the conjecture.
+  // An item is triggered by a relevant symbol s, if s is among its least
+  // common symbols.
+  std::unordered_set<const Symbol*> relevant;
+  std::vector<const Symbol*> current;
+  std::vector<const Symbol*> next;
+  for (const auto& symbol : log->symbols(prefixLength)) {
+    if (isUninterpreted(symbol) && relevant.insert(symbol).second) {
+      current.push_back(symbol);
+    }
+  }
+  for (unsigned round = 0; !current.empty() && (depth == 0 || round < depth);
+       ++round) {
+    for (const auto& symbol : current) {
+      auto count = numberOfOccurrences(symbol);
+      forEachOccurrence(symbol, [&](std::size_t i) {
+        if (result[i] || count > tolerance * leastOccurrences(i)) {
+          return;
+        }
+        result[i] = true;
+        for (const auto& newSymbol : log->symbols(i)) {
+          if (isUninterpreted(newSymbol) && relevant.insert(newSymbol).second) {
+            next.push_back(newSymbol);
+          }
+        }
+      });
+    }
+    current.swap(next);
+    next.clear();
+  }
+  return result;
+}
+
+void ReasoningTask::collectSymbols(
+    std::unordered_set<const Symbol*>& symbols) const {
+  for (std::size_t i = 0; i < prefixLength; ++i) {
+    if (isAxiom(i)) {
+      auto& axiomSymbols = log->symbols(i);
+      symbols.insert(axiomSymbols.begin(), axiomSymbols.end());
+    }
+  }
+  auto& conjectureSymbols = log->symbols(prefixLength);
+  symbols.insert(conjectureSymbols.begin(), conjectureSymbols.end());
+}
+
+void ReasoningTask::outputSMTLIB(std::ostream& ostr) const {
+  auto letBindings = util::Configuration::instance().letBindings();
+
+  writeLogic(ostr);
+
+  // output sort and symbol declarations
+  if (util::Configuration::instance().pruneSignature()) {
+    std::unordered_set<const Symbol*> symbols;
+    collectSymbols(symbols);
+    AxiomLog::writeDeclarationsSMTLIB(ostr, symbols);
+  } else {
+    ostr << log->declarationsSMTLIB();
   }
 
   // output each axiom
-  for (const auto& axiom : axioms) {
-    assert(axiom->type == ProblemItem::Type::Axiom ||
-           axiom->type == ProblemItem::Type::Definition);
-    if (axiom->name != "") {
-      ostr << "\n; "
-           << (axiom->type == ProblemItem::Type::Axiom ? "Axiom: "
-                                                       : "Definition: ")
-           << axiom->name;
+  std::size_t numberOfAxioms = 0;
+  for (std::size_t i = 0; i < prefixLength; ++i) {
+    if (isAxiom(i)) {
+      ostr << log->axiomSMTLIB(i);
+      numberOfAxioms++;
     }
-    ostr << "\n(assert\n" << axiom->formula->toSMTLIB(3) + "\n)\n";
   }
 
+  // sanity check: if explicit mode is used, all axioms must have been found
+  // (note: there could be other axioms too)
+  assert(log->item(prefixLength).fromItems.size() <= numberOfAxioms);
+
   // output conjecture
   assert(conjecture != nullptr);
 
   // if benchmark is used as smtlib-benchmark, replace (assert-not F) by (assert
   // (not F))
   if (util::Configuration::instance().generateBenchmark()) {
-    ostr << "\n; negated conjecture\n"
-         << "(assert\n"
-         << "   (not\n"
-         << conjecture->formula->toSMTLIB(6) << "\n"
-         << "   )\n"
-         << ")\n";
+    writeNegatedConjecture(ostr, *conjecture, letBindings);
   } else {
     if (conjecture->name != "") {
       ostr << "\n; Conjecture: " << conjecture->name;
     }
-    ostr << "\n(assert-not\n" << conjecture->formula->toSMTLIB(3) + "\n)\n";
+    ostr << "\n(assert-not\n";
+    writeFormula(ostr, *conjecture->formula, 3, letBindings);
+    ostr << "\n)\n";
   }
 
   ostr << "\n(check-sat)\n" << std::endl;
 }
 
-std::vector<ReasoningTask> Problem::generateReasoningTasks() const {
-  std::vector<ReasoningTask> tasks;
-
-  for (int i = 0; i < items.size(); ++i) {
-    auto item = items[i];
-
-    // if the item is a lemma or conjecture, generate a new reasoning task to
-    // prove that lemma/conjecture
-    if (item->type == ProblemItem::Type::Lemma ||
-        item->type == ProblemItem::Type::Conjecture) {
-      // collect all previous axioms, which are not hidden or occur in fromItems
-      std::vector<std::shared_ptr<const ProblemItem>> currentAxioms;
-      for (int j = 0; j < i; ++j) {
-        auto curr = items[j];
-
-        if (item->fromItems.empty()) {
-          // implicit mode: collect all axioms visible for implicit mode
-          if ((curr->type == ProblemItem::Type::Axiom ||
-               curr->type == ProblemItem::Type::Definition)) {
-            if (curr->visibility == ProblemItem::Visibility::All ||
-                curr->visibility == ProblemItem::Visibility::Implicit) {
-              currentAxioms.push_back(curr);
-            }
-          } else if (curr->type == ProblemItem::Type::Lemma) {
-            if (curr->visibility == ProblemItem::Visibility::All ||
-                curr->visibility == ProblemItem::Visibility::Implicit) {
-              currentAxioms.push_back(std::make_shared<Axiom>(
-                  curr->formula, "already-proven-lemma " + curr->name));
-            }
+void Problem::generateReasoningTasks(
+    const std::function<bool(const ReasoningTask&)>& consume) const {
+  // normalizing the items up front is equivalent to normalizing each task,
+  // but formulas shared between tasks are only normalized once
+  // the occurrences of symbols are only needed for the axiom selection
+  auto axiomSelection = util::Configuration::instance().axiomSelection();
+  auto log = std::make_shared<AxiomLog>(axiomSelection != "all");
+  Normalizer normalizer;
+  auto normalize = util::Configuration::instance().normalize();
+  for (const auto& item : items) {
+    log->append(normalize ? std::make_shared<ProblemItem>(
+                                item->type, normalizer.rewrite(item->formula),
+                                item->name, item->visibility, item->fromItems)
+                          : item);
+  }
+
+  // each lemma and conjecture needs to be proven from the visible items
+  // preceding it
+  for (std::size_t i = 0; i < log->size(); ++i) {
+    auto& item = log->item(i);
+    if (item.type != ProblemItem::Type::Lemma &&
+        item.type != ProblemItem::Type::Conjecture) {
+      continue;
+    }
+    auto conjecture = std::make_shared<Conjecture>(item.formula, item.name);
+    ReasoningTask task(log, i, conjecture);
+    if (axiomSelection == "all") {
+      if (!consume(task)) {
+        return;
+      }
+      continue;
+    }
+
+    auto selection = task.selectAxiomsSInE(
+        util::Configuration::instance().sineTolerance(),
+        util::Configuration::instance().sineDepth());
+    if (axiomSelection == "both") {
+      // the restricted task is output next to the full one
+      if (!consume(task)) {
+        return;
+      }
+      conjecture =
+          std::make_shared<Conjecture>(item.formula, item.name + "-sine");
+    }
+    if (!consume(ReasoningTask(log, i, conjecture, std::move(selection)))) {
+      return;
+    }
+  }
+}
+
+bool Problem::outputReasoningTasks(
+    const std::function<bool(const ReasoningTask&, std::size_t)>& output,
+    unsigned numberOfThreads) const {
+  // the first error, which is reported once all threads have stopped. An
+  // exception must not escape a writing thread, since it would terminate
+  // rapid.
+  std::string error;
+  auto outputTask = [&output](const ReasoningTask& task, std::size_t index,
+                              std::string& taskError) {
+    try {
+      return output(task, index);
+    } catch (const std::exception& e) {
+      taskError = "Error: Unable to output " + task.conjecture->name + ": " +
+                  e.what() + "\n";
+      return false;
+    }
+  };
+
+  std::size_t nextIndex = 0;
+  bool failed = false;
+  if (numberOfThreads <= 1) {
+    generateReasoningTasks([&](const ReasoningTask& task) {
+      failed = !outputTask(task, nextIndex++, error);
+      return !failed;
+    });
+    std::cout << error;
+    return !failed;
+  }
+
+  // the generated tasks are passed to the writing threads through a bounded
+  // queue, which blocks the generation while it is full
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<std::pair<ReasoningTask, std::size_t>> queue;
+  bool generated = false;
+
+  // the writing threads work in the context of the problem
+  auto context = Context::currentShared();
+  auto write = [&] {
+    Context::setCurrent(context);
+    while (true) {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&] { return !queue.empty() || generated || failed; });
+      if (queue.empty() || failed) {
+        return;
+      }
+      auto [task, index] = queue.front();
+      queue.pop_front();
+      lock.unlock();
+      changed.notify_all();
+
+      std::string taskError;
+      if (!outputTask(task, index, taskError)) {
+        // the remaining tasks are dropped, and the generation stops
+        lock.lock();
+        if (!failed) {
+          error = taskError;
+        }
+        failed = true;
+        queue.clear();
+        lock.unlock();
+        changed.notify_all();
+        return;
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < numberOfThreads; ++i) {
+    threads.emplace_back(write);
+  }
+
+  generateReasoningTasks([&](const ReasoningTask& task) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] {
+      return queue.size() < 2 * numberOfThreads || failed;
+    });
+    if (failed) {
+      return false;
+    }
+    queue.emplace_back(task, nextIndex++);
+    lock.unlock();
+    changed.notify_all();
+    return true;
+  });
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    generated = true;
+  }
+  changed.notify_all();
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::cout << error;
+  return !failed;
+}
+
+namespace {
+
+// the lines of a manifest, which are added concurrently (in any order) and
+// written in the order of the tasks
+class Manifest {
+ public:
+  void set(std::size_t index, std::string line) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (lines.size() <= index) {
+      lines.resize(index + 1);
+    }
+    lines[index] = std::move(line);
+  }
+
+  void writeToFile(const std::string& fileName) const {
+    std::ofstream file(fileName);
+    for (const auto& line : lines) {
+      file << line;
+    }
+  }
+
+ private:
+  std::mutex mutex;
+  std::vector<std::string> lines;
+};
+
+}  // namespace
+
+bool Problem::outputSMTLIBToDir(const std::string& dirPath,
+                                const std::string& preamble,
+                                unsigned numberOfThreads) const {
+  auto cacheDir = util::Configuration::instance().cacheDir();
+  auto writeManifest = util::Configuration::instance().manifest();
+  Manifest cacheManifest;
+  Manifest taskManifest;
+  auto succeeded = outputReasoningTasks(
+      [&](const ReasoningTask& task, std::size_t index) {
+        if (cacheDir.empty()) {
+          if (!task.outputSMTLIBToDir(dirPath, preamble)) {
+            return false;
           }
         } else {
-          // explicit mode: collect all axioms, which are either visible for
-          // explicit mode or occur in fromItems
-          if (curr->visibility == ProblemItem::Visibility::All ||
-              std::find(item->fromItems.begin(), item->fromItems.end(),
-                        curr->name) != item->fromItems.end()) {
-            if ((curr->type == ProblemItem::Type::Axiom ||
-                 curr->type == ProblemItem::Type::Definition)) {
-              currentAxioms.push_back(curr);
-            } else if (curr->type == ProblemItem::Type::Lemma) {
-              currentAxioms.push_back(std::make_shared<Axiom>(
-                  curr->formula, "already-proven-lemma " + curr->name));
-            }
-          }
+          std::string hash;
+          auto isNew =
+              task.outputSMTLIBToCache(dirPath, preamble, cacheDir, hash);
+          cacheManifest.set(index, (isNew ? "new " : "cached ") + hash + " " +
+                                       task.conjecture->name + ".smt2\n");
+        }
+        if (writeManifest) {
+          auto outfileName = dirPath + task.conjecture->name + ".smt2";
+          taskManifest.set(
+              index,
+              manifestEntry(task, std::filesystem::file_size(outfileName)));
+        }
+        return true;
+      },
+      numberOfThreads);
+  if (!succeeded) {
+    return false;
+  }
+
+  if (!cacheDir.empty()) {
+    cacheManifest.writeToFile(dirPath + "cache-manifest.txt");
+  }
+  if (writeManifest) {
+    taskManifest.writeToFile(dirPath + "tasks.jsonl");
+  }
+  return true;
+}
+
+bool Problem::outputSMTLIBToArchive(const std::string& archiveName,
+                                    const std::string& preamble,
+                                    unsigned numberOfThreads) const {
+  TaskArchive archive(archiveName);
+  if (!archive.isOpen()) {
+    return false;
+  }
+  std::cout << "Generating task archive " << archiveName << "\n";
+  auto writeManifest = util::Configuration::instance().manifest();
+  Manifest taskManifest;
+  outputReasoningTasks(
+      [&](const ReasoningTask& task, std::size_t index) {
+        auto bytes = task.outputSMTLIBToArchive(archive, preamble);
+        if (writeManifest) {
+          taskManifest.set(index, manifestEntry(task, bytes));
+        }
+        return true;
+      },
+      numberOfThreads);
+  if (!archive.finish()) {
+    return false;
+  }
+
+  if (writeManifest) {
+    taskManifest.writeToFile(archiveName + ".jsonl");
+  }
+  return true;
+}
+
+bool Problem::outputIncrementalSMTLIBToFile(const std::string& outfileName,
+                                            const std::string& preamble) const {
+  if (std::ifstream(outfileName)) {
+    std::cout << "Error: The output-file " << outfileName << " already exists!"
+              << std::endl;
+    return false;
+  }
+
+  std::cout << "Generating incremental script in " << outfileName << "\n";
+  std::ofstream outfile(outfileName);
+
+  if (!util::Configuration::instance().generateBenchmark()) {
+    outfile << preamble;
+  }
+
+  outputIncrementalSMTLIB(outfile);
+  outfile.close();
+  if (!outfile) {
+    std::cout << "Error: Unable to write the output-file " << outfileName
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void Problem::outputIncrementalSMTLIB(std::ostream& ostr) const {
+  auto letBindings = util::Configuration::instance().letBindings();
+
+  writeLogic(ostr);
+
+  // the axioms visible in implicit mode are asserted permanently, as soon as
+  // they precede the next task
+  auto isPermanent = [](const AxiomLog& log, std::size_t i) {
+    auto visibility = log.item(i).visibility;
+    return log.axiom(i) != nullptr &&
+           (visibility == ProblemItem::Visibility::All ||
+            visibility == ProblemItem::Visibility::Implicit);
+  };
+  const AxiomLog* log = nullptr;
+  std::size_t asserted = 0;
+  // the axioms asserted inside the frame of the previous task
+  auto previousTask = std::numeric_limits<std::size_t>::max();
+  std::vector<std::size_t> previousAxioms;
+  generateReasoningTasks([&](const ReasoningTask& task) {
+    if (log == nullptr) {
+      // the log is complete as soon as the first task is generated
+      log = task.log.get();
+      if (util::Configuration::instance().pruneSignature()) {
+        // the symbols of all items up to the last task
+        std::size_t end = log->size();
+        while (log->item(end - 1).type != ProblemItem::Type::Lemma &&
+               log->item(end - 1).type != ProblemItem::Type::Conjecture) {
+          end--;
         }
+        std::unordered_set<const Symbol*> symbols;
+        for (std::size_t i = 0; i < end; ++i) {
+          auto& itemSymbols = log->symbols(i);
+          symbols.insert(itemSymbols.begin(), itemSymbols.end());
+        }
+        AxiomLog::writeDeclarationsSMTLIB(ostr, symbols);
+      } else {
+        ostr << log->declarationsSMTLIB();
+      }
+    }
+    assert(task.log.get() == log);
+    assert(asserted <= task.prefixLength);
+    for (; asserted < task.prefixLength; ++asserted) {
+      if (isPermanent(*log, asserted)) {
+        ostr << log->axiomSMTLIB(asserted);
       }
+    }
 
-      // sanity check: if explicit mode is used, all axioms must have been found
-      // (note: there could be other axioms too)
-      if (!item->fromItems.empty()) {
-        assert(item->fromItems.size() <= currentAxioms.size());
+    // explicit mode: the hidden axioms occurring in fromItems
+    std::vector<std::size_t> axioms;
+    for (std::size_t i = 0; i < task.prefixLength; ++i) {
+      if (!isPermanent(*log, i) && task.isAxiom(i)) {
+        axioms.push_back(i);
       }
+    }
+    // with -axiomSelection both, the restricted task follows the full one. It
+    // is only checked if SInE drops some of the axioms of the frame, since the
+    // permanent axioms are asserted in both cases.
+    bool isRestrictedDuplicate =
+        previousTask == task.prefixLength && previousAxioms == axioms;
+    previousTask = task.prefixLength;
+    previousAxioms = axioms;
+    if (isRestrictedDuplicate) {
+      return true;
+    }
 
-      // add item as conjecture
-      auto conjecture = std::make_shared<Conjecture>(item->formula, item->name);
-      auto task = ReasoningTask(currentAxioms, conjecture);
-      tasks.push_back(task);
+    auto& item = log->item(task.prefixLength);
+    ostr << "\n; "
+         << (item.type == ProblemItem::Type::Lemma ? "Lemma: " : "Conjecture: ")
+         << task.conjecture->name << "\n(push)\n";
+    for (auto i : axioms) {
+      ostr << log->axiomSMTLIB(i);
     }
+    writeNegatedConjecture(ostr, *task.conjecture, letBindings);
+    ostr << "(check-sat)\n(pop)\n";
+    return true;
+  });
+  if (log != nullptr) {
+    ostr << std::endl;
   }
-  return tasks;
 }
 
 }  // namespace logic
@@ -1,15 +1,22 @@
 #ifndef __Problem__
 #define __Problem__
 
+#include <array>
 #include <cassert>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "Formula.hpp"
 #include "Problem.hpp"
+#include "TaskArchive.hpp"
 
 namespace logic {
 
@@ -97,26 +104,166 @@ class Conjecture : public ProblemItem {
                     ProblemItem::Visibility::All, fromItems) {}
 };
 
+/*
+ * Append-only log of the items of a problem. Each lemma is additionally stored
+ * as the axiom which is used by the reasoning tasks of later items, so that
+ * this axiom is created only once. Reasoning tasks refer to a prefix of the
+ * log instead of copying their axioms.
+ */
+class AxiomLog {
+ public:
+  // if indexSymbols is set, the occurrences of the uninterpreted symbols in
+  // the items are indexed while the items are appended
+  explicit AxiomLog(bool indexSymbols = false) : indexSymbols(indexSymbols) {}
+
+  void append(std::shared_ptr<const ProblemItem> item);
+
+  std::size_t size() const { return items.size(); }
+  const ProblemItem& item(std::size_t i) const { return *items[i]; }
+  // the i-th item as it is used as axiom by later tasks (or nullptr, if it
+  // can't be used as axiom)
+  const std::shared_ptr<const ProblemItem>& axiom(std::size_t i) const {
+    return axioms[i];
+  }
+
+  // the SMTLIB-output of the declarations of the used sorts and the symbols,
+  // and of the i-th axiom. Each is rendered once and then reused by all
+  // tasks (the declarations are rendered again if the signature grew).
+  // Tasks may be output concurrently, as long as no items are appended.
+  std::string declarationsSMTLIB() const;
+  const std::string& axiomSMTLIB(std::size_t i) const;
+
+  // the symbols occurring in the i-th item, including quantified variables.
+  // They are collected once, when they are first needed.
+  const std::vector<const Symbol*>& symbols(std::size_t i) const;
+  // outputs the declarations of the given symbols and of their sorts
+  static void writeDeclarationsSMTLIB(
+      std::ostream& ostr, const std::unordered_set<const Symbol*>& symbols);
+
+  // the indices of the items with the given visibility which can be used as
+  // axioms and in which the uninterpreted symbol occurs, in increasing order.
+  // Only available if the log indexes symbols.
+  const std::vector<std::size_t>& occurrences(
+      const Symbol* symbol, ProblemItem::Visibility visibility) const;
+  // the same for the items without uninterpreted symbols
+  const std::vector<std::size_t>& itemsWithoutSymbols(
+      ProblemItem::Visibility visibility) const;
+  // the indices of the items with the given name
+  const std::vector<std::size_t>& indices(const std::string& name) const;
+
+ private:
+  std::vector<std::shared_ptr<const ProblemItem>> items;
+  std::vector<std::shared_ptr<const ProblemItem>> axioms;
+
+  // indexed by visibility
+  using Occurrences = std::array<std::vector<std::size_t>, 3>;
+  const bool indexSymbols;
+  std::unordered_map<const Symbol*, Occurrences> symbolOccurrences;
+  Occurrences withoutSymbols;
+  std::unordered_map<std::string, std::vector<std::size_t>> indicesByName;
+
+  // the rendered output and the collected symbols of each item, each computed
+  // once (a deque, since once_flags can't be moved)
+  struct Cache {
+    std::once_flag rendered;
+    std::string axiomSMTLIB;
+    std::once_flag collected;
+    std::vector<const Symbol*> symbols;
+  };
+  mutable std::deque<Cache> caches;
+
+  mutable std::mutex declarationsMutex;
+  mutable std::string renderedDeclarations;
+  // the number of sorts and symbols the declarations were rendered for
+  mutable std::pair<std::size_t, std::size_t> declarationsSize = {0, 0};
+};
+
 // represents a first-order reasoning task which can be passed to a prover.
+// the axioms of the task are the items in the first prefixLength entries of the
+// log which are visible to the conjecture, which is the item at index
+// prefixLength of the log.
 // for now sorts and signatures are not part of Problem, maybe should be
 // refactored.
 class ReasoningTask {
  public:
-  ReasoningTask(std::vector<std::shared_ptr<const ProblemItem>> axioms,
-                std::shared_ptr<const Conjecture> conjecture)
-      : axioms(axioms), conjecture(conjecture) {}
+  ReasoningTask(std::shared_ptr<const AxiomLog> log, std::size_t prefixLength,
+                std::shared_ptr<const Conjecture> conjecture,
+                std::vector<bool> selection = {})
+      : log(std::move(log)),
+        prefixLength(prefixLength),
+        conjecture(std::move(conjecture)),
+        selection(std::move(selection)) {
+    assert(prefixLength < this->log->size());
+    assert(this->selection.empty() || this->selection.size() == prefixLength);
+  }
 
-  const std::vector<std::shared_ptr<const ProblemItem>> axioms;
+  const std::shared_ptr<const AxiomLog> log;
+  const std::size_t prefixLength;
   const std::shared_ptr<const Conjecture> conjecture;
+  // if not empty, only the visible items selected here are axioms of the task
+  const std::vector<bool> selection;
+
+  // whether the i-th entry of the log is an axiom of the task
+  bool isAxiom(std::size_t i) const;
+
+  /*
+   * SInE-style relevance filter: returns the visible items which are relevant
+   * for the conjecture (indexed like the log). An item is triggered by a
+   * symbol s occurring in it, if s is among its least common symbols, i.e. if
+   * s occurs in at most tolerance times as many items as the least common
+   * symbol of the item. Starting from the symbols of the conjecture, each
+   * item triggered by a relevant symbol is selected, and its symbols become
+   * relevant, for at most depth rounds (0 means unlimited). Only uninterpreted
+   * symbols are considered. Items without such symbols and items occurring in
+   * fromItems of the conjecture are always selected.
+   */
+  std::vector<bool> selectAxiomsSInE(double tolerance, unsigned depth) const;
+
+  // adds the symbols occurring in the axioms and the conjecture to symbols
+  void collectSymbols(std::unordered_set<const Symbol*>& symbols) const;
+
+  // calls f on each axiom of the task, in order
+  template <typename F>
+  void forEachAxiom(F f) const {
+    for (std::size_t i = 0; i < prefixLength; ++i) {
+      if (isAxiom(i)) {
+        f(*log->axiom(i));
+      }
+    }
+  }
 
   /*
    * generate a new file in the directory 'dirPath' and output the reasoning
    * task in SMTLIB syntax. the preamble string is added at the beginning of the
-   * file.
+   * file. Returns false (after reporting the error) if the file already
+   * exists.
    */
-  void outputSMTLIBToDir(std::string dirPath, std::string preamble) const;
+  bool outputSMTLIBToDir(const std::string& dirPath,
+                         const std::string& preamble) const;
+
+  /*
+   * output the reasoning task like outputSMTLIBToDir, and store it (without
+   * the preamble) in the directory 'cacheDir' under the hash of its content,
+   * unless a file with the same content is stored already. If there is no
+   * preamble, the output-file is a hard link to the cached file, so cached
+   * files are read-only. An existing output-file is replaced. Stores the name
+   * of the cached file (the hash, followed by a number if the hashes of
+   * different tasks collide) in 'hash' and returns whether the task was new.
+   */
+  bool outputSMTLIBToCache(const std::string& dirPath,
+                           const std::string& preamble,
+                           const std::string& cacheDir,
+                           std::string& hash) const;
+
+  // output the reasoning task (including the preamble) as new member of the
+  // archive, and return its size in bytes
+  std::size_t outputSMTLIBToArchive(TaskArchive& archive,
+                                    const std::string& preamble) const;
 
  private:
+  // whether the i-th entry of the log is visible to the conjecture
+  bool isVisible(std::size_t i) const;
+
   void outputSMTLIB(std::ostream& ostr) const;
 };
 
@@ -133,7 +280,65 @@ class Problem {
 
   std::vector<std::shared_ptr<const ProblemItem>> items;
 
-  std::vector<ReasoningTask> generateReasoningTasks() const;
+  // generates the reasoning tasks in order and passes each to consume as soon
+  // as it is generated, so that the tasks don't need to be kept in memory
+  // together. Stops as soon as consume returns false.
+  void generateReasoningTasks(
+      const std::function<bool(const ReasoningTask&)>& consume) const;
+
+  /*
+   * generate the reasoning tasks and output each into a new file in the
+   * directory 'dirPath' (see ReasoningTask::outputSMTLIBToDir), using the
+   * given number of threads. Only a few tasks per thread are kept in memory
+   * at the same time.
+   * If a cache directory is set, the tasks are output using
+   * ReasoningTask::outputSMTLIBToCache, and the file cache-manifest.txt in
+   * 'dirPath' lists for each task whether it is new or cached.
+   * If the manifest is enabled, the file tasks.jsonl in 'dirPath' contains a
+   * JSON object for each task (in order), with the files of the lemmas it
+   * depends on, its number of axioms, its size in bytes and the number of
+   * declared symbols occurring in it.
+   * Returns false if a task couldn't be output (e.g. since its output-file
+   * exists already).
+   */
+  bool outputSMTLIBToDir(const std::string& dirPath,
+                         const std::string& preamble,
+                         unsigned numberOfThreads) const;
+
+  /*
+   * generate the reasoning tasks and output them as a single incremental
+   * SMTLIB script into a new file. The declarations are output once, each
+   * axiom is asserted once, and each conjecture is checked in its own
+   * push/pop-block. Since asserted axioms are kept, a task in explicit mode
+   * also sees the axioms visible in implicit mode.
+   * Returns false if the file exists already or can't be written.
+   */
+  bool outputIncrementalSMTLIBToFile(const std::string& outfileName,
+                                     const std::string& preamble) const;
+
+  /*
+   * generate the reasoning tasks and output them into a single new archive
+   * (see TaskArchive), using the given number of threads. The order of the
+   * tasks in the archive depends on the order in which the threads finish
+   * them. If the manifest is enabled, it is written next to the archive, with
+   * the extension .jsonl appended.
+   * Returns false if the archive exists already or can't be written. An
+   * incomplete archive is removed.
+   */
+  bool outputSMTLIBToArchive(const std::string& archiveName,
+                             const std::string& preamble,
+                             unsigned numberOfThreads) const;
+
+ private:
+  // passes each generated task and its index to output, using the given
+  // number of threads. As soon as output fails for a task (i.e. returns
+  // false or throws), no further tasks are generated or output, and false is
+  // returned once all threads have stopped. An exception is reported as
+  // error.
+  bool outputReasoningTasks(
+      const std::function<bool(const ReasoningTask&, std::size_t)>& output,
+      unsigned numberOfThreads) const;
+  void outputIncrementalSMTLIB(std::ostream& ostr) const;
 };
 }  // namespace logic
 #endif
@@ -0,0 +1,353 @@
+#include "SharingWriter.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace logic {
+
+namespace {
+
+// variables and constants are written as they are and never bound using let.
+// Note that the variables of quantifiers in user-given formulas occur as
+// nullary function terms, not as LVariables.
+bool isAtomic(const Term& t) {
+  return t.type() == Term::Type::Variable ||
+         static_cast<const FuncTerm&>(t).subterms.empty();
+}
+
+}  // namespace
+
+void SharingWriter::writeSMTLIB(std::ostream& ostr, const Formula& f,
+                                unsigned indentation) {
+  SharingWriter writer(ostr);
+
+  writer.enterScope(nullptr);
+  writer.count(f);
+  writer.leaveScope();
+
+  // the second pass visits the scopes in the same order as the first one
+  writer.nextScopeId = 0;
+  writer.enterScope(nullptr);
+  writer.writeScopeBody(f, indentation);
+  writer.leaveScope();
+}
+
+void SharingWriter::enterScope(
+    const std::vector<std::shared_ptr<const Symbol>>* vars) {
+  scopes.emplace_back(vars, nextScopeId++);
+  if (occurrences.size() < nextScopeId) {
+    occurrences.resize(nextScopeId);
+  }
+}
+
+void SharingWriter::leaveScope() {
+  assert(!scopes.empty());
+  scopes.pop_back();
+}
+
+unsigned SharingWriter::level(const Term& t) {
+  auto& levels = scopes.back().levels;
+  auto it = levels.find(&t);
+  if (it != levels.end()) {
+    return it->second;
+  }
+
+  unsigned result = 0;
+  if (isAtomic(t)) {
+    // bound by the innermost quantifier with a variable of the same symbol
+    for (unsigned i = scopes.size(); i-- > 0;) {
+      auto vars = scopes[i].vars;
+      if (vars != nullptr &&
+          std::any_of(vars->begin(), vars->end(),
+                      [&](const auto& var) { return *var == *t.symbol; })) {
+        result = i;
+        break;
+      }
+    }
+  } else {
+    auto& funcTerm = static_cast<const FuncTerm&>(t);
+    for (const auto& subterm : funcTerm.subterms) {
+      result = std::max(result, level(*subterm));
+    }
+  }
+  levels[&t] = result;
+  return result;
+}
+
+#pragma mark - Counting
+
+void SharingWriter::count(const Formula& f) {
+  switch (f.type()) {
+    case Formula::Type::Predicate: {
+      for (const auto& subterm :
+           static_cast<const PredicateFormula&>(f).subterms) {
+        count(*subterm);
+      }
+      break;
+    }
+    case Formula::Type::Equality: {
+      auto& eq = static_cast<const EqualityFormula&>(f);
+      count(*eq.left);
+      count(*eq.right);
+      break;
+    }
+    case Formula::Type::Conjunction: {
+      auto& conjunction = static_cast<const ConjunctionFormula&>(f);
+      for (const auto& conjunct : conjunction.conj) {
+        count(*conjunct);
+      }
+      break;
+    }
+    case Formula::Type::Disjunction: {
+      auto& disjunction = static_cast<const DisjunctionFormula&>(f);
+      for (const auto& disjunct : disjunction.disj) {
+        count(*disjunct);
+      }
+      break;
+    }
+    case Formula::Type::Negation: {
+      count(*static_cast<const NegationFormula&>(f).f);
+      break;
+    }
+    case Formula::Type::Existential: {
+      auto& quantified = static_cast<const ExistentialFormula&>(f);
+      enterScope(&quantified.vars);
+      count(*quantified.f);
+      leaveScope();
+      break;
+    }
+    case Formula::Type::Universal: {
+      auto& quantified = static_cast<const UniversalFormula&>(f);
+      enterScope(&quantified.vars);
+      count(*quantified.f);
+      leaveScope();
+      break;
+    }
+    case Formula::Type::Implication: {
+      auto& implication = static_cast<const ImplicationFormula&>(f);
+      count(*implication.f1);
+      count(*implication.f2);
+      break;
+    }
+    case Formula::Type::Equivalence: {
+      auto& equivalence = static_cast<const EquivalenceFormula&>(f);
+      count(*equivalence.f1);
+      count(*equivalence.f2);
+      break;
+    }
+    case Formula::Type::True:
+    case Formula::Type::False: {
+      break;
+    }
+  }
+}
+
+void SharingWriter::count(const Term& t) {
+  if (isAtomic(t)) {
+    return;
+  }
+  auto& funcTerm = static_cast<const FuncTerm&>(t);
+
+  auto& occ = occurrences[scopes[level(t)].id];
+  // only count the subterms of the first occurrence, since all other
+  // occurrences will be replaced by the name of the term
+  if (occ.counts[&t]++ == 0) {
+    for (const auto& subterm : funcTerm.subterms) {
+      count(*subterm);
+    }
+    occ.terms.push_back(&t);
+  }
+}
+
+#pragma mark - Output
+
+void SharingWriter::writeScopeBody(const Formula& f, unsigned indentation) {
+  auto& occ = occurrences[scopes.back().id];
+
+  // bind each term occurring more than once, if the let is shorter than the
+  // repeated occurrences. Subterms are bound before the terms containing them,
+  // so each let can refer to the previous ones.
+  unsigned numberOfLets = 0;
+  for (const auto& t : occ.terms) {
+    auto count = occ.counts[t];
+    auto name = "_let" + std::to_string(nextName);
+    if (count > 1 && (count - 1) * length(*t) >
+                         (count + 1) * name.size() + indentation + 10) {
+      nextName++;
+      writeIndentation(ostr, indentation);
+      ostr << "(let ((" << name << " ";
+      write(*t);
+      ostr << "))\n";
+      scopes.back().names[t] = name;
+      numberOfLets++;
+    }
+  }
+
+  write(f, indentation);
+
+  if (numberOfLets > 0) {
+    ostr << "\n";
+    writeIndentation(ostr, indentation);
+    ostr << std::string(numberOfLets, ')');
+  }
+}
+
+void SharingWriter::write(const Formula& f, unsigned indentation) {
+  // like Formula::writeSMTLIB, the label of a non-empty disjunction is not
+  // printed
+  if (f.type() != Formula::Type::Disjunction ||
+      static_cast<const DisjunctionFormula&>(f).disj.empty()) {
+    f.writeLabel(ostr, indentation);
+  }
+  writeIndentation(ostr, indentation);
+
+  switch (f.type()) {
+    case Formula::Type::Predicate: {
+      auto& predicate = static_cast<const PredicateFormula&>(f);
+      if (predicate.subterms.empty()) {
+        predicate.symbol->writeSMTLIB(ostr);
+      } else {
+        ostr << "(";
+        predicate.symbol->writeSMTLIB(ostr);
+        for (const auto& subterm : predicate.subterms) {
+          ostr << " ";
+          write(*subterm);
+        }
+        ostr << ")";
+      }
+      break;
+    }
+    case Formula::Type::Equality: {
+      auto& eq = static_cast<const EqualityFormula&>(f);
+      ostr << (eq.polarity ? "(= " : "(not (= ");
+      write(*eq.left);
+      ostr << " ";
+      write(*eq.right);
+      ostr << (eq.polarity ? ")" : "))");
+      break;
+    }
+    case Formula::Type::Conjunction:
+    case Formula::Type::Disjunction: {
+      bool isConjunction = f.type() == Formula::Type::Conjunction;
+      auto& subformulas =
+          isConjunction ? static_cast<const ConjunctionFormula&>(f).conj
+                        : static_cast<const DisjunctionFormula&>(f).disj;
+      if (subformulas.empty()) {
+        ostr << (isConjunction ? "true" : "false");
+        break;
+      }
+      ostr << (isConjunction ? "(and\n" : "(or\n");
+      for (const auto& subformula : subformulas) {
+        write(*subformula, indentation + 3);
+        ostr << "\n";
+      }
+      writeIndentation(ostr, indentation);
+      ostr << ")";
+      break;
+    }
+    case Formula::Type::Negation: {
+      ostr << "(not\n";
+      write(*static_cast<const NegationFormula&>(f).f, indentation + 3);
+      ostr << "\n";
+      writeIndentation(ostr, indentation);
+      ostr << ")";
+      break;
+    }
+    case Formula::Type::Existential:
+    case Formula::Type::Universal: {
+      bool isExistential = f.type() == Formula::Type::Existential;
+      auto& vars = isExistential
+                       ? static_cast<const ExistentialFormula&>(f).vars
+                       : static_cast<const UniversalFormula&>(f).vars;
+      auto& subformula = isExistential
+                             ? static_cast<const ExistentialFormula&>(f).f
+                             : static_cast<const UniversalFormula&>(f).f;
+      ostr << (isExistential ? "(exists (" : "(forall (");
+      for (const auto& var : vars) {
+        ostr << "(" << var->name << " " << var->rngSort->toSMTLIB() << ")";
+      }
+      ostr << ")\n";
+
+      enterScope(&vars);
+      writeScopeBody(*subformula, indentation + 3);
+      leaveScope();
+
+      ostr << "\n";
+      writeIndentation(ostr, indentation);
+      ostr << ")";
+      break;
+    }
+    case Formula::Type::Implication:
+    case Formula::Type::Equivalence: {
+      bool isImplication = f.type() == Formula::Type::Implication;
+      auto& f1 = isImplication ? static_cast<const ImplicationFormula&>(f).f1
+                               : static_cast<const EquivalenceFormula&>(f).f1;
+      auto& f2 = isImplication ? static_cast<const ImplicationFormula&>(f).f2
+                               : static_cast<const EquivalenceFormula&>(f).f2;
+      ostr << (isImplication ? "(=>\n" : "(=\n");
+      write(*f1, indentation + 3);
+      ostr << "\n";
+      write(*f2, indentation + 3);
+      ostr << "\n";
+      writeIndentation(ostr, indentation);
+      ostr << ")";
+      break;
+    }
+    case Formula::Type::True: {
+      ostr << "true";
+      break;
+    }
+    case Formula::Type::False: {
+      ostr << "false";
+      break;
+    }
+  }
+}
+
+std::size_t SharingWriter::length(const Term& t) {
+  if (isAtomic(t)) {
+    return t.toSMTLIB().size();
+  }
+  auto& funcTerm = static_cast<const FuncTerm&>(t);
+
+  auto& names = scopes[level(t)].names;
+  auto it = names.find(&t);
+  if (it != names.end()) {
+    return it->second.size();
+  }
+
+  std::size_t result = 2 + funcTerm.symbol->name.size();
+  for (const auto& subterm : funcTerm.subterms) {
+    result += 1 + length(*subterm);
+  }
+  return result;
+}
+
+void SharingWriter::write(const Term& t) {
+  if (isAtomic(t)) {
+    t.writeSMTLIB(ostr);
+    return;
+  }
+  auto& funcTerm = static_cast<const FuncTerm&>(t);
+
+  auto& names = scopes[level(t)].names;
+  auto it = names.find(&t);
+  if (it != names.end()) {
+    ostr << it->second;
+    return;
+  }
+
+  ostr << "(";
+  funcTerm.symbol->writeSMTLIB(ostr);
+  for (const auto& subterm : funcTerm.subterms) {
+    ostr << " ";
+    write(*subterm);
+  }
+  ostr << ")";
+}
+
+}  // namespace logic
@@ -0,0 +1,78 @@
+#ifndef __SharingWriter__
+#define __SharingWriter__
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Formula.hpp"
+#include "Term.hpp"
+
+namespace logic {
+
+/*
+ * Writes a formula in SMTLIB syntax like Formula::writeSMTLIB, but each
+ * compound term occurring more than once is bound using let and afterwards
+ * referenced by its name (if this shrinks the output). A term is bound
+ * directly inside the innermost quantifier binding one of its variables (or
+ * around the whole formula, if the term is ground), so that all its
+ * occurrences are in the scope of the let.
+ */
+class SharingWriter {
+ public:
+  static void writeSMTLIB(std::ostream& ostr, const Formula& f,
+                          unsigned indentation);
+
+ private:
+  SharingWriter(std::ostream& ostr) : ostr(ostr) {}
+
+  // a formula or a quantifier, in which terms can be bound
+  struct Scope {
+    Scope(const std::vector<std::shared_ptr<const Symbol>>* vars, unsigned id)
+        : vars(vars), id(id) {}
+
+    const std::vector<std::shared_ptr<const Symbol>>* vars;
+    const unsigned id;
+
+    // the index of the innermost scope binding a variable of each term
+    // visited while this scope is the innermost one
+    std::unordered_map<const Term*, unsigned> levels;
+    // the names of the terms bound in this scope
+    std::unordered_map<const Term*, std::string> names;
+  };
+
+  // the terms which occur in a scope (in post-order, so that subterms come
+  // before the terms containing them), together with their number of
+  // occurrences
+  struct Occurrences {
+    std::vector<const Term*> terms;
+    std::unordered_map<const Term*, unsigned> counts;
+  };
+
+  std::ostream& ostr;
+  std::vector<Scope> scopes;
+  std::vector<Occurrences> occurrences;  // indexed by scope id
+  unsigned nextScopeId = 0;
+  unsigned nextName = 0;
+
+  void enterScope(const std::vector<std::shared_ptr<const Symbol>>* vars);
+  void leaveScope();
+  unsigned level(const Term& t);
+
+  // first pass: count occurrences of terms
+  void count(const Formula& f);
+  void count(const Term& t);
+
+  // second pass: output formula
+  void writeScopeBody(const Formula& f, unsigned indentation);
+  void write(const Formula& f, unsigned indentation);
+  void write(const Term& t);
+  // the number of characters write(t) outputs
+  std::size_t length(const Term& t);
+};
+
+}  // namespace logic
+
+#endif
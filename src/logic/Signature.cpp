@@ -4,11 +4,13 @@
 #include <cassert>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "Context.hpp"
 #include "Options.hpp"
 
 namespace logic {
@@ -50,94 +52,116 @@ std::string Symbol::declareSymbolSMTLIB() const {
   }
 }
 
-std::string Symbol::toSMTLIB() const {
-  // if non-negative integer constant
-  if (std::all_of(name.begin(), name.end(), ::isdigit)) {
-    return name;
-  }
+void Symbol::writeSMTLIB(std::ostream& ostr) const {
   // if negative integer constant
-  else if (name[0] == '-' && name.size() > 1 &&
-           std::all_of(name.begin() + 1, name.end(), ::isdigit)) {
+  if (name[0] == '-' && name.size() > 1 &&
+      std::all_of(name.begin() + 1, name.end(), ::isdigit)) {
     // need to encode negative integer as unary minus of positive integer
-    return "(- " + name.substr(1, name.size() - 1) + ")";
-  } else {
-    return name;
+    ostr << "(- ";
+    ostr.write(name.data() + 1, name.size() - 1);
+    ostr << ")";
+  }
+  // otherwise (in particular if non-negative integer constant)
+  else {
+    ostr << name;
   }
 }
 
+std::string Symbol::toSMTLIB() const {
+  std::stringstream str;
+  writeSMTLIB(str);
+  return str.str();
+}
+
 #pragma mark - Signature
 
-std::unordered_map<std::string, std::shared_ptr<const Symbol>>
-    Signature::_signature;
-std::vector<std::shared_ptr<const Symbol>>
-    Signature::_signatureOrderedByInsertion;
+Signature& Signature::current() { return Context::current().signature; }
 
-bool Signature::isDeclared(std::string name) {
-  auto it = _signature.find(name);
-  return (it != _signature.end());
+bool Signature::isDeclared(const std::string& name) {
+  auto& symbols = current().symbols;
+  return symbols.find(name) != symbols.end();
 }
 
 std::shared_ptr<const Symbol> Signature::add(std::string name,
                                              std::vector<const Sort*> argSorts,
                                              const Sort* rngSort,
                                              bool noDeclaration) {
+  auto& signature = current();
   // there must be no symbol with name name already added
-  assert(_signature.count(name) == 0);
+  assert(signature.symbols.count(name) == 0);
 
-  auto pair = _signature.insert(std::make_pair(
-      name, std::unique_ptr<Symbol>(
-                new Symbol(name, argSorts, rngSort, false, noDeclaration))));
+  auto symbol = adoptNode(new Symbol(signature.nextId++, name,
+                                     std::move(argSorts), rngSort, false,
+                                     noDeclaration));
+  auto pair = signature.symbols.insert(std::make_pair(std::move(name), symbol));
   assert(pair.second);  // must succeed since we checked that no such symbols
                         // existed before the insertion
 
-  auto symbol = pair.first->second;
-  _signatureOrderedByInsertion.push_back(symbol);
+  signature.symbolsOrderedByInsertion.push_back(symbol);
   return symbol;
 }
 
-std::shared_ptr<const Symbol> Signature::fetch(std::string name) {
-  auto it = _signature.find(name);
-  assert(it != _signature.end());
+std::shared_ptr<const Symbol> Signature::fetch(const std::string& name) {
+  auto symbol = tryFetch(name);
+  assert(symbol != nullptr);
 
-  return it->second;
+  return symbol;
+}
+
+std::shared_ptr<const Symbol> Signature::tryFetch(const std::string& name) {
+  auto& symbols = current().symbols;
+  auto it = symbols.find(name);
+  return it != symbols.end() ? it->second : nullptr;
 }
 
 std::shared_ptr<const Symbol> Signature::fetchOrAdd(
-    std::string name, std::vector<const Sort*> argSorts, const Sort* rngSort,
-    bool isLemmaPredicate, bool noDeclaration) {
-  auto pair = _signature.insert(std::make_pair(
-      name, std::shared_ptr<Symbol>(new Symbol(
-                name, argSorts, rngSort, isLemmaPredicate, noDeclaration))));
-  auto symbol = pair.first->second;
-
-  if (pair.second) {
-    _signatureOrderedByInsertion.push_back(symbol);
+    const std::string& name, std::vector<const Sort*> argSorts,
+    const Sort* rngSort, bool isLemmaPredicate, bool noDeclaration) {
+  auto& signature = current();
+  auto it = signature.symbols.find(name);
+  if (it == signature.symbols.end()) {
+    auto symbol =
+        adoptNode(new Symbol(signature.nextId++, name, std::move(argSorts),
+                             rngSort, isLemmaPredicate, noDeclaration));
+    signature.symbols.insert(std::make_pair(name, symbol));
+    signature.symbolsOrderedByInsertion.push_back(symbol);
+    return symbol;
   }
+
   // if a symbol with the name already exist, make sure it has the same sorts
   // and attributes
-  else {
-    if (argSorts.size() != symbol->argSorts.size()) {
-      std::cout << "User error: symbol " << symbol->name << " requires "
-                << symbol->argSorts.size() << " arguments, but "
-                << argSorts.size() << " arguments where given" << std::endl;
-      assert(false);
-    }
-    for (int i = 0; i < argSorts.size(); ++i) {
-      assert(argSorts[i] == symbol->argSorts[i]);
-    }
-    assert(rngSort = symbol->rngSort);
-    assert(isLemmaPredicate == symbol->isLemmaPredicate);
-    assert(noDeclaration == symbol->noDeclaration);
+  auto symbol = it->second;
+  if (argSorts.size() != symbol->argSorts.size()) {
+    std::cout << "User error: symbol " << symbol->name << " requires "
+              << symbol->argSorts.size() << " arguments, but "
+              << argSorts.size() << " arguments where given" << std::endl;
+    assert(false);
   }
+  for (unsigned i = 0; i < argSorts.size(); ++i) {
+    assert(argSorts[i] == symbol->argSorts[i]);
+  }
+  assert(rngSort = symbol->rngSort);
+  assert(isLemmaPredicate == symbol->isLemmaPredicate);
+  assert(noDeclaration == symbol->noDeclaration);
   return symbol;
 }
 
-std::shared_ptr<const Symbol> Signature::varSymbol(std::string name,
+std::shared_ptr<const Symbol> Signature::varSymbol(const std::string& name,
                                                    const Sort* rngSort) {
+  auto& signature = current();
   // there must be no symbol with name name already added
-  assert(_signature.count(name) == 0);
+  assert(signature.symbols.count(name) == 0);
 
-  return std::shared_ptr<Symbol>(new Symbol(name, rngSort, false, true));
+  auto& symbols = signature.varSymbols[name];
+  for (const auto& symbol : symbols) {
+    if (symbol->rngSort == rngSort) {
+      return symbol;
+    }
+  }
+  auto symbol =
+      adoptNode(new Symbol(signature.nextId++, name, rngSort, false, true));
+  symbols.push_back(symbol);
+  return symbol;
 }
 
 }  // namespace logic
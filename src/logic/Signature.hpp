@@ -11,22 +11,24 @@
 #include <utility>
 #include <vector>
 
+#include "Arena.hpp"
 #include "Sort.hpp"
 
 #pragma mark - Symbol
 
 namespace logic {
 
-class Symbol {
+class Symbol : public ArenaAllocated {
   // we need each symbol to be either declared in the signature or to be a
   // variable (which will be declared by the quantifier) We use the
-  // Signature-class below as a manager-class for symbols of the first kind
+  // Signature-class below as a manager-class for symbols of both kinds
   friend class Signature;
 
  private:
-  Symbol(std::string name, const Sort* rngSort, bool isLemmaPredicate,
-         bool noDeclaration)
-      : name(name),
+  Symbol(unsigned id, std::string name, const Sort* rngSort,
+         bool isLemmaPredicate, bool noDeclaration)
+      : id(id),
+        name(name),
         argSorts(),
         rngSort(rngSort),
         isLemmaPredicate(isLemmaPredicate),
@@ -35,9 +37,10 @@ class Symbol {
     assert(!isLemmaPredicate || isPredicateSymbol());
   }
 
-  Symbol(std::string name, std::vector<const Sort*> argSorts,
+  Symbol(unsigned id, std::string name, std::vector<const Sort*> argSorts,
          const Sort* rngSort, bool isLemmaPredicate, bool noDeclaration)
-      : name(name),
+      : id(id),
+        name(name),
         argSorts(std::move(argSorts)),
         rngSort(rngSort),
         isLemmaPredicate(isLemmaPredicate),
@@ -47,6 +50,9 @@ class Symbol {
   }
 
  public:
+  // dense id, unique among the symbols of a signature. Variable symbols are
+  // interned by name and sort, so each symbol is identified by its id.
+  const unsigned id;
   const std::string name;
   const std::vector<const Sort*> argSorts;
   const Sort* rngSort;
@@ -59,12 +65,13 @@ class Symbol {
 
   bool isPredicateSymbol() const { return rngSort == Sorts::boolSort(); }
 
+  void writeSMTLIB(std::ostream& ostr) const;
   std::string toSMTLIB() const;
   std::string declareSymbolSMTLIB() const;
   std::string declareSymbolColorSMTLIB() const;
 
-  bool operator==(const Symbol& s) const { return name == s.name; }
-  bool operator!=(const Symbol& s) const { return !(name == s.name); }
+  bool operator==(const Symbol& s) const { return id == s.id; }
+  bool operator!=(const Symbol& s) const { return id != s.id; }
 };
 
 // hack needed for bison: std::vector has no overload for ostream, but these
@@ -82,7 +89,7 @@ struct hash<logic::Symbol> {
   using result_type = std::size_t;
 
   result_type operator()(argument_type const& s) const {
-    return std::hash<std::string>()(s.name);
+    return std::hash<unsigned>()(s.id);
   }
 };
 
@@ -92,7 +99,7 @@ struct hash<const logic::Symbol> {
   using result_type = std::size_t;
 
   result_type operator()(argument_type const& s) const {
-    return std::hash<std::string>()(s.name);
+    return std::hash<unsigned>()(s.id);
   }
 };
 }  // namespace std
@@ -101,38 +108,49 @@ struct hash<const logic::Symbol> {
 
 namespace logic {
 
-// We use Signature as a manager-class for Symbol-instances
+// We use Signature as a manager-class for Symbol-instances.
+// The symbols of a problem are held by a Signature-object. The static functions
+// below operate on the signature of the current Context.
 class Signature {
  public:
-  static bool isDeclared(std::string name);
+  static Signature& current();
+
+  static bool isDeclared(const std::string& name);
 
   // construct new symbols
   static std::shared_ptr<const Symbol> add(std::string name,
                                            std::vector<const Sort*> argSorts,
                                            const Sort* rngSort,
                                            bool noDeclaration = false);
-  static std::shared_ptr<const Symbol> fetch(std::string name);
+  static std::shared_ptr<const Symbol> fetch(const std::string& name);
+  // returns nullptr if no symbol with the given name exists
+  static std::shared_ptr<const Symbol> tryFetch(const std::string& name);
   static std::shared_ptr<const Symbol> fetchOrAdd(
-      std::string name, std::vector<const Sort*> argSorts, const Sort* rngSort,
-      bool isLemmaPredicate = false, bool noDeclaration = false);
+      const std::string& name, std::vector<const Sort*> argSorts,
+      const Sort* rngSort, bool isLemmaPredicate = false,
+      bool noDeclaration = false);
 
   // check that variable doesn't use name which already occurs in Signature
-  // return Symbol without adding it to Signature
-  static std::shared_ptr<const Symbol> varSymbol(std::string name,
+  // return Symbol without adding it to Signature (but the same symbol for the
+  // same name and sort)
+  static std::shared_ptr<const Symbol> varSymbol(const std::string& name,
                                                  const Sort* rngSort);
 
   static const std::vector<std::shared_ptr<const Symbol>>&
   signatureOrderedByInsertion() {
-    return _signatureOrderedByInsertion;
+    return current().symbolsOrderedByInsertion;
   }
 
  private:
-  // _signature collects all symbols used so far.
-  static std::unordered_map<std::string, std::shared_ptr<const Symbol>>
-      _signature;
-  // symbols of signature, in the order of insertion.
-  static std::vector<std::shared_ptr<const Symbol>>
-      _signatureOrderedByInsertion;
+  // symbols collects all declared symbols used so far.
+  std::unordered_map<std::string, std::shared_ptr<const Symbol>> symbols;
+  // declared symbols, in the order of insertion.
+  std::vector<std::shared_ptr<const Symbol>> symbolsOrderedByInsertion;
+  // variable symbols for each name (usually just one, but different sorts
+  // are possible)
+  std::unordered_map<std::string, std::vector<std::shared_ptr<const Symbol>>>
+      varSymbols;
+  unsigned nextId = 0;
 };
 }  // namespace logic
 #endif
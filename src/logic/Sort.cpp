@@ -1,44 +1,37 @@
 #include "Sort.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "Context.hpp"
 #include "Options.hpp"
 
 namespace logic {
 
 #pragma mark - Sort
 
-std::string Sort::toSMTLIB() const {
-  if (name == "Int") {
-    return "Int";
-  } else if (name == "Bool") {
-    return "Bool";
-  } else {
-    return name;
-  }
-}
-
 std::string declareSortSMTLIB(const Sort& s) {
-  if (s.toSMTLIB() == "Int" || s.toSMTLIB() == "Bool") {
-    // SMTLIB already knows Int and Bool.
-    return "";
-  } else if (s.toSMTLIB() == "Nat") {
-    if (util::Configuration::instance().nativeNat()) {
-      return "(declare-nat Nat zero s p Sub)\n";
-    } else {
-      return "(declare-datatypes ((Nat 0)) (( (zero) (s (p Nat)) )) )\n";
-    }
-  } else {
-    return "(declare-sort " + s.toSMTLIB() + " 0)\n";
+  switch (s.kind) {
+    case Sort::Kind::Bool:
+    case Sort::Kind::Int:
+      // SMTLIB already knows Int and Bool.
+      return "";
+    case Sort::Kind::Nat:
+      if (util::Configuration::instance().nativeNat()) {
+        return "(declare-nat Nat zero s p Sub)\n";
+      } else {
+        return "(declare-datatypes ((Nat 0)) (( (zero) (s (p Nat)) )) )\n";
+      }
+    default:
+      return "(declare-sort " + s.toSMTLIB() + " 0)\n";
   }
 }
 
-bool Sort::operator==(Sort& o) { return name == o.name; }
-
 std::ostream& operator<<(std::ostream& ostr, const Sort& s) {
   ostr << s.name;
   return ostr;
@@ -46,18 +39,61 @@ std::ostream& operator<<(std::ostream& ostr, const Sort& s) {
 
 #pragma mark - Sorts
 
-std::map<std::string, std::unique_ptr<Sort>> Sorts::_sorts;
+Sort* Sorts::builtinSort(Sort::Kind kind) {
+  auto index = static_cast<std::size_t>(kind);
+  auto& isBuiltinSortUsed = Context::current().sorts.isBuiltinSortUsed;
+  // only written the first time, so that concurrent readers don't race
+  if (!isBuiltinSortUsed[index]) {
+    isBuiltinSortUsed[index] = true;
+  }
+  return &builtinSorts()[index];
+}
+
+Sort* Sorts::builtinSorts() {
+  // function-local, so that the built-in sorts are available during static
+  // initialization. The order coincides with Sort::Kind.
+  static Sort sorts[] = {
+      Sort("Bool", Sort::Kind::Bool), Sort("Int", Sort::Kind::Int),
+      Sort("Nat", Sort::Kind::Nat),   Sort("Time", Sort::Kind::Time),
+      Sort("Trace", Sort::Kind::Trace),
+  };
+  return sorts;
+}
 
-Sort* Sorts::fetchOrDeclare(std::string name) {
-  auto it = _sorts.find(name);
+Sort* Sorts::fetchOrDeclare(const std::string& name) {
+  for (std::size_t i = 0; i < numberOfBuiltinSorts; ++i) {
+    if (builtinSorts()[i].name == name) {
+      return builtinSort(static_cast<Sort::Kind>(i));
+    }
+  }
 
-  if (it == _sorts.end()) {
-    auto ret = _sorts.insert(
-        std::make_pair(name, std::unique_ptr<Sort>(new Sort(name))));
+  auto& userSorts = Context::current().sorts.userSorts;
+  auto it = userSorts.find(name);
+  if (it == userSorts.end()) {
+    auto ret = userSorts.insert(std::make_pair(
+        name,
+        std::unique_ptr<Sort>(new Sort(name, Sort::Kind::Uninterpreted))));
     return ret.first->second.get();
   } else {
     return (*it).second.get();
   }
 }
 
+std::vector<const Sort*> Sorts::usedSorts() {
+  auto& state = Context::current().sorts;
+  std::vector<const Sort*> sorts;
+  for (std::size_t i = 0; i < numberOfBuiltinSorts; ++i) {
+    if (state.isBuiltinSortUsed[i]) {
+      sorts.push_back(&builtinSorts()[i]);
+    }
+  }
+  for (const auto& pair : state.userSorts) {
+    sorts.push_back(pair.second.get());
+  }
+  std::sort(sorts.begin(), sorts.end(), [](const Sort* s1, const Sort* s2) {
+    return s1->name < s2->name;
+  });
+  return sorts;
+}
+
 }  // namespace logic
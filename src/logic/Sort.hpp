@@ -1,10 +1,12 @@
 #ifndef __Sort__
 #define __Sort__
 
+#include <cstddef>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace logic {
 
@@ -15,16 +17,23 @@ class Sort {
   // We therefore use the Sorts-class below as a manager-class for Sort-objects
   friend class Sorts;
 
+ public:
+  // the built-in sorts, and Uninterpreted for all sorts added by the user
+  enum class Kind { Bool, Int, Nat, Time, Trace, Uninterpreted };
+
  private:
   // constructor is private to prevent accidental usage.
-  Sort(std::string name) : name(name){};
+  Sort(std::string name, Kind kind) : name(name), kind(kind){};
 
  public:
   const std::string name;
+  const Kind kind;
 
-  bool operator==(Sort& o);
+  // sorts are unique, so equality is identity
+  bool operator==(const Sort& o) const { return this == &o; }
 
-  std::string toSMTLIB() const;
+  // the name of a sort coincides with its SMTLIB-representation
+  const std::string& toSMTLIB() const { return name; }
 };
 std::ostream& operator<<(std::ostream& ostr, const Sort& s);
 
@@ -37,21 +46,36 @@ std::string declareSortSMTLIB(const Sort& s);
 class Sorts {
  public:
   // construct various sorts
-  static Sort* boolSort() { return fetchOrDeclare("Bool"); }
-  static Sort* intSort() { return fetchOrDeclare("Int"); }
-  static Sort* natSort() { return fetchOrDeclare("Nat"); }
-  static Sort* timeSort() { return fetchOrDeclare("Time"); }
-  static Sort* traceSort() { return fetchOrDeclare("Trace"); }
-
-  // returns map containing all previously constructed sorts as pairs
-  // (nameOfSort, Sort)
-  static const std::map<std::string, std::unique_ptr<Sort>>& nameToSort() {
-    return _sorts;
+  static Sort* boolSort() { return builtinSort(Sort::Kind::Bool); }
+  static Sort* intSort() { return builtinSort(Sort::Kind::Int); }
+  static Sort* natSort() { return builtinSort(Sort::Kind::Nat); }
+  static Sort* timeSort() { return builtinSort(Sort::Kind::Time); }
+  static Sort* traceSort() { return builtinSort(Sort::Kind::Trace); }
+
+  // returns the built-in sort with the given name, or the user sort with the
+  // given name (which is added if it doesn't exist yet)
+  static Sort* fetchOrDeclare(const std::string& name);
+
+  // returns all previously used sorts, ordered by name
+  static std::vector<const Sort*> usedSorts();
+
+ private:
+  static const std::size_t numberOfBuiltinSorts =
+      static_cast<std::size_t>(Sort::Kind::Uninterpreted);
+
+ public:
+  // the sorts of a Context
+  class State {
+    friend class Sorts;
+
+    // built-in sorts are only declared in the output if they have been used
+    bool isBuiltinSortUsed[numberOfBuiltinSorts] = {};
+    std::map<std::string, std::unique_ptr<Sort>> userSorts;
   };
 
  private:
-  static Sort* fetchOrDeclare(std::string name);
-  static std::map<std::string, std::unique_ptr<Sort>> _sorts;
+  static Sort* builtinSort(Sort::Kind kind);
+  static Sort* builtinSorts();
 };
 
 }  // namespace logic
@@ -0,0 +1,152 @@
+#include "TaskArchive.hpp"
+
+#include <cassert>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+namespace logic {
+
+namespace {
+
+// the trailer is a comment, followed by the offset of the index padded to 20
+// digits, so that it has a fixed length
+const std::string trailerPrefix = "\n; task index at byte ";
+const std::size_t trailerLength = trailerPrefix.size() + 20 + 1;
+
+// errors are reported on std::cerr, since the extracted task may be output on
+// std::cout
+[[noreturn]] void exitNotAnArchive(const std::string& fileName) {
+  std::cerr << "Error: " << fileName << " is not a task archive" << std::endl;
+  exit(1);
+}
+
+}  // namespace
+
+TaskArchive::TaskArchive(const std::string& fileName) : fileName(fileName) {
+  if (std::ifstream(fileName)) {
+    std::cout << "Error: The output-file " << fileName << " already exists!"
+              << std::endl;
+    return;
+  }
+  file.open(fileName, std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << "Error: Unable to create the output-file " << fileName
+              << std::endl;
+    return;
+  }
+  isIncomplete = true;
+}
+
+TaskArchive::~TaskArchive() {
+  if (isIncomplete) {
+    file.close();
+    std::remove(fileName.c_str());
+  }
+}
+
+bool TaskArchive::finish() {
+  assert(file.is_open());
+  auto indexOffset = size;
+  for (const auto& entry : index) {
+    file << entry.offset << " " << entry.size << " " << entry.name << "\n";
+  }
+  file << trailerPrefix << std::setw(20) << std::setfill('0') << indexOffset
+       << "\n";
+  file.close();
+  if (!file.good()) {
+    std::cout << "Error: Unable to write the output-file " << fileName
+              << std::endl;
+    return false;
+  }
+  isIncomplete = false;
+  return true;
+}
+
+void TaskArchive::add(const std::string& name, const std::string& content) {
+  assert(name.find('\n') == std::string::npos);
+  std::lock_guard<std::mutex> lock(mutex);
+  index.push_back({size, content.size(), name});
+  file << content;
+  size += content.size();
+}
+
+std::vector<TaskArchive::Entry> TaskArchive::readIndex(
+    std::ifstream& file, const std::string& fileName) {
+  if (!file) {
+    std::cerr << "Error: Unable to read file " << fileName << std::endl;
+    exit(1);
+  }
+  std::string trailer(trailerLength, '\0');
+  file.seekg(0, std::ios::end);
+  auto fileSize = static_cast<std::uint64_t>(file.tellg());
+  if (fileSize < trailerLength) {
+    exitNotAnArchive(fileName);
+  }
+  file.seekg(fileSize - trailerLength);
+  file.read(&trailer[0], trailerLength);
+  if (!file || trailer.compare(0, trailerPrefix.size(), trailerPrefix) != 0 ||
+      trailer.back() != '\n') {
+    exitNotAnArchive(fileName);
+  }
+
+  // the offset must consist of digits only and precede the trailer
+  std::uint64_t indexOffset = 0;
+  auto digits = trailer.data() + trailerPrefix.size();
+  auto digitsEnd = trailer.data() + trailerLength - 1;
+  auto result = std::from_chars(digits, digitsEnd, indexOffset);
+  if (result.ec != std::errc() || result.ptr != digitsEnd ||
+      indexOffset > fileSize - trailerLength) {
+    exitNotAnArchive(fileName);
+  }
+
+  file.seekg(indexOffset);
+  std::string indexString(fileSize - trailerLength - indexOffset, '\0');
+  file.read(&indexString[0], indexString.size());
+  if (!file) {
+    exitNotAnArchive(fileName);
+  }
+
+  // each task must precede the index
+  std::vector<Entry> entries;
+  std::istringstream lines(indexString);
+  Entry entry;
+  while (lines >> entry.offset >> entry.size) {
+    if (entry.offset > indexOffset || entry.size > indexOffset - entry.offset) {
+      exitNotAnArchive(fileName);
+    }
+    lines.get();  // the space before the name
+    std::getline(lines, entry.name);
+    entries.push_back(entry);
+  }
+  if (!lines.eof()) {
+    exitNotAnArchive(fileName);
+  }
+  return entries;
+}
+
+void TaskArchive::writeNames(const std::string& fileName, std::ostream& ostr) {
+  std::ifstream file(fileName, std::ios::binary);
+  for (const auto& entry : readIndex(file, fileName)) {
+    ostr << entry.name << "\n";
+  }
+}
+
+bool TaskArchive::extract(const std::string& fileName, const std::string& name,
+                          std::ostream& ostr) {
+  std::ifstream file(fileName, std::ios::binary);
+  for (const auto& entry : readIndex(file, fileName)) {
+    if (entry.name == name) {
+      std::string content(entry.size, '\0');
+      file.seekg(entry.offset);
+      file.read(&content[0], entry.size);
+      ostr << content;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace logic
@@ -0,0 +1,64 @@
+#ifndef __TaskArchive__
+#define __TaskArchive__
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace logic {
+
+/*
+ * A single file containing many reasoning tasks. The tasks are stored one
+ * after another, followed by an index with a line "<offset> <size> <name>"
+ * for each task and a trailer of fixed length containing the offset of the
+ * index. A task can therefore be read without scanning the whole archive.
+ */
+class TaskArchive {
+ public:
+  // creates the archive, which must not exist yet. Otherwise, or if the
+  // archive can't be created, an error is reported and isOpen() is false.
+  TaskArchive(const std::string& fileName);
+  // removes the archive, unless finish() succeeded, so that an incomplete
+  // archive doesn't prevent the next run
+  ~TaskArchive();
+
+  bool isOpen() const { return file.is_open(); }
+
+  // appends the task to the archive. Can be called concurrently.
+  void add(const std::string& name, const std::string& content);
+
+  // writes the index and the trailer, and closes the archive. Reports an
+  // error and returns false if writing the archive failed.
+  bool finish();
+
+  // outputs the names of the tasks in the archive, one per line
+  static void writeNames(const std::string& fileName, std::ostream& ostr);
+  // outputs the task with the given name. Returns false if the archive
+  // doesn't contain such a task.
+  static bool extract(const std::string& fileName, const std::string& name,
+                      std::ostream& ostr);
+
+ private:
+  struct Entry {
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::string name;
+  };
+
+  const std::string fileName;
+  std::ofstream file;
+  bool isIncomplete = false;  // created, but not finished
+  std::mutex mutex;
+  std::uint64_t size = 0;
+  std::vector<Entry> index;
+
+  static std::vector<Entry> readIndex(std::ifstream& file,
+                                      const std::string& fileName);
+};
+
+}  // namespace logic
+
+#endif
@@ -2,9 +2,14 @@
 
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "Context.hpp"
+
 namespace logic {
 
 // hack needed for bison: std::vector has no overload for ostream, but these
@@ -22,45 +27,43 @@ std::ostream& operator<<(
   return ostr;
 }
 
-unsigned LVariable::freshId = 0;
-
-bool operator==(const Term& t1, const Term& t2) {
-  if (t1.type() != t2.type()) {
-    return false;
-  }
-  if (t1.type() == Term::Type::Variable) {
-    return *t1.symbol == *t2.symbol;
-  } else {
-    assert(t1.type() == Term::Type::FuncTerm);
-    auto f1 = static_cast<const FuncTerm&>(t1);
-    auto f2 = static_cast<const FuncTerm&>(t2);
-    if (*f1.symbol != *f2.symbol || f1.subterms.size() != f2.subterms.size()) {
-      return false;
-    }
-    for (unsigned i = 0; i < f1.subterms.size(); i++) {
-      if (*f1.subterms[i] != *f2.subterms[i]) {
-        return false;
-      }
-    }
-    return true;
+std::size_t termHash(Term::Type type, const Symbol& symbol,
+                     const std::vector<std::shared_ptr<const Term>>& subterms) {
+  // start from symbol of term
+  size_t result = std::hash<const logic::Symbol>()(symbol);
+  // then integrate type into the hash
+  result = hashCombine(result, std::hash<logic::Term::Type>()(type));
+  // finally integrate each subterm into the hash
+  for (const auto& subterm : subterms) {
+    result = hashCombine(result, subterm->hash);
   }
+  return result;
 }
+
+bool operator==(const Term& t1, const Term& t2) { return &t1 == &t2; }
 bool operator!=(const Term& t1, const Term& t2) { return !(t1 == t2); }
 
-std::string LVariable::toSMTLIB() const { return symbol->name; }
+std::string Term::toSMTLIB() const {
+  std::stringstream str;
+  writeSMTLIB(str);
+  return str.str();
+}
+
+void LVariable::writeSMTLIB(std::ostream& ostr) const { ostr << symbol->name; }
 
 std::string LVariable::prettyString() const { return symbol->name; }
 
-std::string FuncTerm::toSMTLIB() const {
+void FuncTerm::writeSMTLIB(std::ostream& ostr) const {
   if (subterms.size() == 0) {
-    return symbol->toSMTLIB();
+    symbol->writeSMTLIB(ostr);
   } else {
-    std::string str = "(" + symbol->toSMTLIB() + " ";
-    for (unsigned i = 0; i < subterms.size(); i++) {
-      str += subterms[i]->toSMTLIB();
-      str += (i == subterms.size() - 1) ? ")" : " ";
+    ostr << "(";
+    symbol->writeSMTLIB(ostr);
+    for (const auto& subterm : subterms) {
+      ostr << " ";
+      subterm->writeSMTLIB(ostr);
     }
-    return str;
+    ostr << ")";
   }
 }
 
@@ -79,26 +82,85 @@ std::string FuncTerm::prettyString() const {
 
 #pragma mark - Terms
 
+bool Terms::TermKey::operator==(const TermKey& other) const {
+  if (type != other.type || *symbol != *other.symbol) {
+    return false;
+  }
+  if (subterms == nullptr || other.subterms == nullptr) {
+    return subterms == other.subterms;
+  }
+  if (subterms->size() != other.subterms->size()) {
+    return false;
+  }
+  for (unsigned i = 0; i < subterms->size(); i++) {
+    if ((*subterms)[i].get() != (*other.subterms)[i].get()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::size_t Terms::TermKeyHash::operator()(const TermKey& key) const {
+  if (key.subterms == nullptr) {
+    return termHash(key.type, *key.symbol, {});
+  }
+  return termHash(key.type, *key.symbol, *key.subterms);
+}
+
 std::shared_ptr<const LVariable> Terms::var(
     std::shared_ptr<const Symbol> symbol) {
-  return std::shared_ptr<const LVariable>(new LVariable(symbol));
+  auto& state = Context::current().terms;
+  auto it =
+      state.terms.find(TermKey{Term::Type::Variable, symbol.get(), nullptr});
+  if (it != state.terms.end()) {
+    return std::static_pointer_cast<const LVariable>(it->second);
+  }
+
+  auto term = adoptNode<const LVariable>(
+      new LVariable(symbol, state.nextVariableId++));
+  state.terms.insert(std::make_pair(
+      TermKey{Term::Type::Variable, term->symbol.get(), nullptr}, term));
+  return term;
 }
 
 std::shared_ptr<const FuncTerm> Terms::func(
     std::string name, std::vector<std::shared_ptr<const Term>> subterms,
     const Sort* sort, bool noDeclaration) {
-  std::vector<const Sort*> subtermSorts;
-  for (const auto& subterm : subterms) {
-    subtermSorts.push_back(subterm->symbol->rngSort);
+  // only collect the sorts of the subterms if the symbol needs to be added
+  // (or if the arity doesn't match, so that fetchOrAdd reports the error)
+  auto symbol = Signature::tryFetch(name);
+  if (symbol == nullptr || symbol->argSorts.size() != subterms.size()) {
+    std::vector<const Sort*> subtermSorts;
+    for (const auto& subterm : subterms) {
+      subtermSorts.push_back(subterm->symbol->rngSort);
+    }
+    symbol =
+        Signature::fetchOrAdd(name, subtermSorts, sort, false, noDeclaration);
+  }
+  assert(symbol->rngSort == sort);
+  // fetchOrAdd also checks the argument sorts, which the fast path skips
+  for (unsigned i = 0; i < subterms.size(); ++i) {
+    assert(subterms[i]->symbol->rngSort == symbol->argSorts[i]);
   }
-  auto symbol =
-      Signature::fetchOrAdd(name, subtermSorts, sort, false, noDeclaration);
-  return std::shared_ptr<const FuncTerm>(new FuncTerm(symbol, subterms));
+  assert(!symbol->isLemmaPredicate);
+  assert(symbol->noDeclaration == noDeclaration);
+  return func(symbol, std::move(subterms));
 }
 
 std::shared_ptr<const FuncTerm> Terms::func(
     std::shared_ptr<const Symbol> symbol,
     std::vector<std::shared_ptr<const Term>> subterms) {
-  return std::shared_ptr<const FuncTerm>(new FuncTerm(symbol, subterms));
+  auto& terms = Context::current().terms.terms;
+  auto it = terms.find(TermKey{Term::Type::FuncTerm, symbol.get(), &subterms});
+  if (it != terms.end()) {
+    return std::static_pointer_cast<const FuncTerm>(it->second);
+  }
+
+  auto term = adoptNode<const FuncTerm>(
+      new FuncTerm(symbol, std::move(subterms)));
+  terms.insert(std::make_pair(
+      TermKey{Term::Type::FuncTerm, term->symbol.get(), &term->subterms},
+      term));
+  return term;
 }
 }  // namespace logic
@@ -5,55 +5,75 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "Arena.hpp"
 #include "Signature.hpp"
 #include "Sort.hpp"
 
 namespace logic {
 
-class Term {
+// combine 'value' into the hash 'seed' (as done by boost::hash_combine)
+inline std::size_t hashCombine(std::size_t seed, std::size_t value) {
+  return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+class Term : public ArenaAllocated {
  public:
-  Term(std::shared_ptr<const Symbol> symbol) : symbol(symbol) {}
+  Term(std::shared_ptr<const Symbol> symbol, std::size_t hash)
+      : symbol(symbol), hash(hash) {}
   virtual ~Term() {}
 
   std::shared_ptr<const Symbol> symbol;
 
+  // structural hash of the term, computed once during construction from the
+  // hashes of the subterms
+  const std::size_t hash;
+
   enum class Type {
     Variable,
     FuncTerm,
   };
   virtual Type type() const = 0;
 
-  virtual std::string toSMTLIB() const = 0;
+  // writes the term in SMTLIB syntax directly into ostr
+  virtual void writeSMTLIB(std::ostream& ostr) const = 0;
+  std::string toSMTLIB() const;
   virtual std::string prettyString() const = 0;
 };
 
+// compute the structural hash of a term with the given type, symbol and
+// subterms, using the cached hashes of the subterms.
+std::size_t termHash(Term::Type type, const Symbol& symbol,
+                     const std::vector<std::shared_ptr<const Term>>& subterms);
+
+// terms are hash-consed by Terms, so structurally equal terms are represented
+// by the same instance and equality reduces to a pointer-comparison.
 bool operator==(const Term& t1, const Term& t2);
 bool operator!=(const Term& t1, const Term& t2);
 
 class LVariable : public Term {
   friend class Terms;
 
-  LVariable(std::shared_ptr<const Symbol> symbol)
-      : Term(symbol), id(freshId++) {}
+  LVariable(std::shared_ptr<const Symbol> symbol, unsigned id)
+      : Term(symbol, termHash(Term::Type::Variable, *symbol, {})), id(id) {}
 
  public:
   const unsigned id;
 
   Type type() const override { return Term::Type::Variable; }
-  std::string toSMTLIB() const override;
+  void writeSMTLIB(std::ostream& ostr) const override;
   virtual std::string prettyString() const override;
-
-  static unsigned freshId;
 };
 
 class FuncTerm : public Term {
   friend class Terms;
   FuncTerm(std::shared_ptr<const Symbol> symbol,
            std::vector<std::shared_ptr<const Term>> subterms)
-      : Term(symbol), subterms(std::move(subterms)) {
+      : Term(symbol, termHash(Term::Type::FuncTerm, *symbol, subterms)),
+        subterms(std::move(subterms)) {
     assert(this->symbol->argSorts.size() == this->subterms.size());
     for (int i = 0; i < this->symbol->argSorts.size(); ++i) {
       assert(this->symbol->argSorts[i] == this->subterms[i]->symbol->rngSort);
@@ -64,12 +84,12 @@ class FuncTerm : public Term {
   const std::vector<std::shared_ptr<const Term>> subterms;
 
   Type type() const override { return Term::Type::FuncTerm; }
-  std::string toSMTLIB() const override;
+  void writeSMTLIB(std::ostream& ostr) const override;
   virtual std::string prettyString() const override;
 };
 
 inline std::ostream& operator<<(std::ostream& ostr, const Term& e) {
-  ostr << e.toSMTLIB();
+  e.writeSMTLIB(ostr);
   return ostr;
 }
 
@@ -90,33 +110,15 @@ struct hash<const logic::Term> {
   using argument_type = const logic::Term;
   using result_type = std::size_t;
 
-  result_type operator()(argument_type const& t) const {
-    // start from symbol of term
-    size_t result = std::hash<const logic::Symbol>()(*t.symbol);
-    // then integrate type into the hash
-    result ^= std::hash<logic::Term::Type>()(t.type()) + 0x9e3779b9 +
-              (result << 6) + (result >> 2);
-    if (t.type() == logic::Term::Type::Variable) {
-      // for an LVariable, finally integrate id into the hash
-      auto castedTerm = dynamic_cast<const logic::LVariable&>(t);
-      result ^= std::hash<unsigned>()(castedTerm.id) + 0x9e3779b9 +
-                (result << 6) + (result >> 2);
-    } else {
-      // for a FuncTerm, integrate each subterm into the hash
-      auto castedTerm = dynamic_cast<const logic::FuncTerm&>(t);
-      for (const auto& subterm : castedTerm.subterms) {
-        result ^= std::hash<const logic::Term>()(*subterm) + 0x9e3779b9 +
-                  (result << 6) + (result >> 2);
-      }
-    }
-    return result;
-  }
+  result_type operator()(argument_type const& t) const { return t.hash; }
 };
 }  // namespace std
 
 #pragma mark - Terms
 namespace logic {
-// We use Terms as a manager-class for Term-instances
+// We use Terms as a manager-class for Term-instances.
+// Terms are hash-consed: constructing a term which is structurally equal to a
+// previously constructed term returns the previously constructed instance.
 class Terms {
  public:
   // construct new terms
@@ -128,6 +130,33 @@ class Terms {
   static std::shared_ptr<const FuncTerm> func(
       std::shared_ptr<const Symbol> symbol,
       std::vector<std::shared_ptr<const Term>> subterms);
+
+ private:
+  // key identifying a term up to structural equality. Since subterms are
+  // already hash-consed, it suffices to compare the subterms by address.
+  // 'subterms' either points to the arguments of a lookup or to the subterms
+  // of the stored term itself, so no copy of the subterms is needed.
+  struct TermKey {
+    Term::Type type;
+    const Symbol* symbol;
+    const std::vector<std::shared_ptr<const Term>>* subterms;
+
+    bool operator==(const TermKey& other) const;
+  };
+  struct TermKeyHash {
+    std::size_t operator()(const TermKey& key) const;
+  };
+
+ public:
+  // the terms of a Context
+  class State {
+    friend class Terms;
+
+    // collects all terms constructed so far
+    std::unordered_map<TermKey, std::shared_ptr<const Term>, TermKeyHash>
+        terms;
+    unsigned nextVariableId = 0;
+  };
 };
 }  // namespace logic
 #endif
@@ -1,14 +1,27 @@
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "analysis/Semantics.hpp"
 #include "analysis/TheoryAxioms.hpp"
 #include "analysis/TraceLemmas.hpp"
+#include "logic/Context.hpp"
 #include "logic/Problem.hpp"
+#include "logic/TaskArchive.hpp"
 #include "logic/Theory.hpp"
 #include "parser/WhileParserWrapper.hpp"
 #include "program/Program.hpp"
@@ -17,6 +30,208 @@
 
 void outputUsage() {
   std::cout << "Usage: rapid -dir <outputDir> <filename>" << std::endl;
+  std::cout << "       rapid -batch on -dir <outputDir> <directory or list>"
+            << std::endl;
+  std::cout << "       rapid -extract <task> <archive>" << std::endl;
+  std::cout << "       rapid -serve on [options]" << std::endl;
+}
+
+// the number of threads to use, where 0 means one per hardware thread
+unsigned numberOfThreads(unsigned option) {
+  return option == 0 ? std::max(1u, std::thread::hardware_concurrency())
+                     : option;
+}
+
+// outputs the reasoning tasks of the parsed spec into outputDir, where a
+// script or archive containing all tasks is named after the spec. Returns
+// false if the tasks couldn't be output (the error has been reported).
+bool generateReasoningTasks(parser::WhileParserResult parserResult,
+                            const std::string& name,
+                            const std::string& outputDir) {
+  // generate problem
+  std::vector<std::shared_ptr<const logic::ProblemItem>> problemItems;
+
+  analysis::TheoryAxioms theoryAxiomsGenerator;
+  auto theoryAxioms = theoryAxiomsGenerator.generate();
+  for (const auto& axiom : theoryAxioms) {
+    problemItems.push_back(axiom);
+  }
+
+  analysis::Semantics s(*parserResult.program,
+                        parserResult.locationToActiveVars,
+                        parserResult.problemItems, parserResult.numberOfTraces);
+  auto [semantics, inlinedVarValues] = s.generateSemantics();
+  problemItems.insert(problemItems.end(), semantics.begin(), semantics.end());
+
+  auto traceLemmas = analysis::generateTraceLemmas(
+      *parserResult.program, parserResult.locationToActiveVars,
+      parserResult.numberOfTraces, semantics, inlinedVarValues);
+  problemItems.insert(problemItems.end(), traceLemmas.begin(),
+                      traceLemmas.end());
+
+  problemItems.insert(problemItems.end(), parserResult.problemItems.begin(),
+                      parserResult.problemItems.end());
+
+  logic::Problem problem(problemItems);
+
+  // generate reasoning tasks, convert each reasoning task to smtlib, and
+  // output it to output-file. The tasks are written as soon as they are
+  // generated.
+  // the preamble is the same for all tasks
+  std::stringstream preamble;
+  preamble << util::Output::comment << *parserResult.program
+           << util::Output::nocomment;
+  auto preambleString = preamble.str();
+  auto threads = numberOfThreads(util::Configuration::instance().threads());
+  if (util::Configuration::instance().incremental()) {
+    return problem.outputIncrementalSMTLIBToFile(outputDir + name + ".smt2",
+                                                 preambleString);
+  } else if (util::Configuration::instance().archive()) {
+    return problem.outputSMTLIBToArchive(outputDir + name + ".tasks",
+                                         preambleString, threads);
+  } else {
+    return problem.outputSMTLIBToDir(outputDir, preambleString, threads);
+  }
+}
+
+// parses the spec in inputFile and outputs its reasoning tasks into outputDir.
+// Returns false if the spec couldn't be parsed or its tasks couldn't be output.
+bool generateReasoningTasks(const std::string& inputFile,
+                            const std::string& outputDir) {
+  // check that inputFile ends in ".spec"
+  std::string extension = ".spec";
+  assert(inputFile.size() > extension.size());
+  assert(inputFile.compare(inputFile.size() - extension.size(),
+                           extension.size(), extension) == 0);
+  auto inputFileWithoutExtension =
+      inputFile.substr(0, inputFile.size() - extension.size());
+
+  // parse inputFile
+  auto parserResult = parser::parse(inputFile);
+  if (!parserResult) {
+    return false;
+  }
+
+  return generateReasoningTasks(
+      std::move(*parserResult),
+      inputFileWithoutExtension.substr(
+          inputFileWithoutExtension.find_last_of('/') + 1),
+      outputDir);
+}
+
+// serves the requests read from stdin, one per line. A request consists of
+// options followed by a spec file, as on the command line, where the options
+// given when starting the server are the defaults. If the spec file is "-",
+// the text of the spec follows on the next lines, terminated by a line ".",
+// and its script or archive is named "inline". The response to a request is
+// its output, followed by a line "done" or "failed".
+// Each request is processed by a forked copy of the server, so that it starts
+// from the state of the server, without paying for a new process, and an
+// error only ends the request. The server declares the theories and sorts
+// once, so that requests start with them declared.
+void serve() {
+  // the parser declares the theories first, so declaring them in advance
+  // doesn't change the output. The declaration of Sub depends on -nat.
+  logic::Theory::declareTheories();
+  bool serverNativeNat = util::Configuration::instance().nativeNat();
+
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    std::vector<std::string> args = {"rapid"};
+    std::istringstream words(line);
+    for (std::string word; words >> word;) {
+      args.push_back(word);
+    }
+    if (args.size() == 1) {
+      continue;
+    }
+
+    // the text of an inline spec must be read before forking, since the
+    // input read by the child is lost for the server
+    std::string specText;
+    bool isInline = args.back() == "-";
+    if (isInline) {
+      std::string specLine;
+      while (std::getline(std::cin, specLine) && specLine != ".") {
+        specText += specLine + "\n";
+      }
+    }
+
+    std::cout.flush();
+    auto pid = fork();
+    if (pid == 0) {
+      // the child must not touch the input of the server: exiting would
+      // otherwise move the shared offset of stdin back to the position of
+      // the child's copy of the stdin-buffer
+      int devNull = open("/dev/null", O_RDONLY);
+      if (devNull < 0 || dup2(devNull, STDIN_FILENO) < 0) {
+        std::cout << "Error: Unable to detach from the input" << std::endl;
+        _exit(1);
+      }
+      close(devNull);
+
+      std::vector<char*> argv;
+      for (auto& arg : args) {
+        argv.push_back(&arg[0]);
+      }
+      auto& configuration = util::Configuration::instance();
+      if (!configuration.setAllValues(argv.size(), argv.data())) {
+        exit(1);
+      }
+      if (configuration.nativeNat() != serverNativeNat) {
+        logic::Context::setCurrent(std::make_shared<logic::Context>());
+      }
+      auto outputDir = configuration.outputDir();
+      if (outputDir == "") {
+        std::cout << "Error: dir parameter required" << std::endl;
+        exit(1);
+      }
+      bool succeeded = false;
+      if (isInline) {
+        auto parserResult = parser::parseText("inline.spec", specText);
+        succeeded = parserResult && generateReasoningTasks(
+                                        std::move(*parserResult), "inline",
+                                        outputDir);
+      } else {
+        succeeded = generateReasoningTasks(args.back(), outputDir);
+      }
+      exit(succeeded ? 0 : 1);
+    }
+
+    int status = 0;
+    bool succeeded = pid > 0 && waitpid(pid, &status, 0) == pid &&
+                     WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    std::cout << (succeeded ? "done" : "failed") << std::endl;
+  }
+}
+
+// the specs to process in batch mode: all specs in the directory inputPath
+// (recursively, in lexicographic order), or the specs listed in the file
+// inputPath (one per line)
+std::vector<std::string> batchInputFiles(const std::string& inputPath) {
+  std::vector<std::string> inputFiles;
+  if (std::filesystem::is_directory(inputPath)) {
+    for (const auto& entry :
+         std::filesystem::recursive_directory_iterator(inputPath)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".spec") {
+        inputFiles.push_back(entry.path().string());
+      }
+    }
+    std::sort(inputFiles.begin(), inputFiles.end());
+  } else {
+    std::ifstream list(inputPath);
+    if (!list) {
+      std::cout << "Error: Unable to read file " << inputPath << std::endl;
+      exit(1);
+    }
+    std::string line;
+    while (std::getline(list, line)) {
+      if (!line.empty()) {
+        inputFiles.push_back(line);
+      }
+    }
+  }
+  return inputFiles;
 }
 
 int main(int argc, char* argv[]) {
@@ -25,18 +240,27 @@ int main(int argc, char* argv[]) {
   } else {
     if (util::Configuration::instance().setAllValues(argc, argv)) {
       if (util::Output::initialize()) {
-        std::string inputFile = argv[argc - 1];
+        if (util::Configuration::instance().serve()) {
+          serve();
+          return 0;
+        }
 
-        // check that inputFile ends in ".spec"
-        std::string extension = ".spec";
-        assert(inputFile.size() > extension.size());
-        assert(inputFile.compare(inputFile.size() - extension.size(),
-                                 extension.size(), extension) == 0);
-        auto inputFileWithoutExtension =
-            inputFile.substr(0, inputFile.size() - extension.size());
+        std::string inputFile = argv[argc - 1];
 
-        // parse inputFile
-        auto parserResult = parser::parse(inputFile);
+        // output a task from an archive, e.g. to pipe it into a prover
+        auto taskName = util::Configuration::instance().extract();
+        if (taskName != "") {
+          if (!logic::TaskArchive::extract(inputFile, taskName, std::cout) &&
+              !logic::TaskArchive::extract(inputFile, taskName + ".smt2",
+                                           std::cout)) {
+            std::cerr << "Error: The archive " << inputFile
+                      << " contains no task " << taskName
+                      << ", but the tasks:" << std::endl;
+            logic::TaskArchive::writeNames(inputFile, std::cerr);
+            exit(1);
+          }
+          return 0;
+        }
 
         // setup outputDir
         auto outputDir = util::Configuration::instance().outputDir();
@@ -45,42 +269,65 @@ int main(int argc, char* argv[]) {
           exit(1);
         }
 
-        // generate problem
-        std::vector<std::shared_ptr<const logic::ProblemItem>> problemItems;
+        if (!util::Configuration::instance().batch()) {
+          return generateReasoningTasks(inputFile, outputDir) ? 0 : 1;
+        }
+
+        // the tasks of each spec are output into their own subdirectory,
+        // named after the path of the spec. The specs are processed by a pool
+        // of jobs, each taking the next spec which is not processed yet. A
+        // spec which fails is reported, and doesn't stop the other specs.
+        auto specFiles = batchInputFiles(inputFile);
+        std::atomic<std::size_t> nextSpec(0);
+        // not std::vector<bool>, so that the jobs can set their entries
+        // concurrently
+        std::vector<char> failed(specFiles.size(), false);
+        auto processSpecs = [&] {
+          for (auto i = nextSpec++; i < specFiles.size(); i = nextSpec++) {
+            auto& specFile = specFiles[i];
+            auto name = specFile.substr(0, specFile.rfind(".spec"));
+            std::replace(name.begin(), name.end(), '/', '_');
+            auto specOutputDir = outputDir + name + "/";
+            std::cout << ("Processing " + specFile + "\n");
+            std::error_code error;
+            std::filesystem::create_directories(specOutputDir, error);
+            if (error) {
+              std::cout << ("Error: Unable to create the directory " +
+                            specOutputDir + "\n");
+            }
+
+            // each spec is processed in a new logic context, exactly as in a
+            // new process
+            logic::Context::setCurrent(std::make_shared<logic::Context>());
+            if (error || !generateReasoningTasks(specFile, specOutputDir)) {
+              failed[i] = true;
+              std::cout << ("Error: Processing " + specFile + " failed\n");
+            }
+          }
+          logic::Context::setCurrent(nullptr);
+        };
 
-        analysis::TheoryAxioms theoryAxiomsGenerator;
-        auto theoryAxioms = theoryAxiomsGenerator.generate();
-        for (const auto& axiom : theoryAxioms) {
-          problemItems.push_back(axiom);
+        std::vector<std::thread> jobs;
+        auto numberOfJobs =
+            numberOfThreads(util::Configuration::instance().jobs());
+        for (unsigned i = 1; i < numberOfJobs; ++i) {
+          jobs.emplace_back(processSpecs);
+        }
+        processSpecs();
+        for (auto& job : jobs) {
+          job.join();
         }
 
-        analysis::Semantics s(
-            *parserResult.program, parserResult.locationToActiveVars,
-            parserResult.problemItems, parserResult.numberOfTraces);
-        auto [semantics, inlinedVarValues] = s.generateSemantics();
-        problemItems.insert(problemItems.end(), semantics.begin(),
-                            semantics.end());
-
-        auto traceLemmas = analysis::generateTraceLemmas(
-            *parserResult.program, parserResult.locationToActiveVars,
-            parserResult.numberOfTraces, semantics, inlinedVarValues);
-        problemItems.insert(problemItems.end(), traceLemmas.begin(),
-                            traceLemmas.end());
-
-        problemItems.insert(problemItems.end(),
-                            parserResult.problemItems.begin(),
-                            parserResult.problemItems.end());
-
-        logic::Problem problem(problemItems);
-
-        // generate reasoning tasks, convert each reasoning task to smtlib, and
-        // output it to output-file
-        auto tasks = problem.generateReasoningTasks();
-        for (const auto& task : tasks) {
-          std::stringstream preamble;
-          preamble << util::Output::comment << *parserResult.program
-                   << util::Output::nocomment;
-          task.outputSMTLIBToDir(outputDir, preamble.str());
+        auto numberOfFailed = std::count(failed.begin(), failed.end(), true);
+        if (numberOfFailed > 0) {
+          std::cout << "Error: " << numberOfFailed << " of "
+                    << specFiles.size() << " specs failed:" << std::endl;
+          for (std::size_t i = 0; i < specFiles.size(); ++i) {
+            if (failed[i]) {
+              std::cout << specFiles[i] << std::endl;
+            }
+          }
+          return 1;
         }
       }
     }
@@ -1,9 +1,15 @@
 #ifndef __WhileParserWrapper__
 #define __WhileParserWrapper__
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -39,46 +45,156 @@ namespace parser
     };
     
     /*
-     * main method for parsing input. Internally calls the parser autogenerated by Flex and Bison.
+     * The contents of a file, followed by the two null-bytes which flex expects
+     * at the end of a buffer, so that the scanner can work on it in place.
+     * The file is mapped into memory (privately, since the scanner temporarily
+     * writes into the buffer), unless the null-bytes don't fit into the last
+     * page of the mapping. In that case, the file is read into a buffer.
      */
-    WhileParserResult parse(std::string inputFile)
+    class InputBuffer
     {
-        // test readbility, easier than catching exception thrown by parser
-        std::ifstream istr(inputFile);
-        if (!istr)
+    public:
+        InputBuffer(const std::string& inputFile)
+        {
+            int fd = open(inputFile.c_str(), O_RDONLY);
+            struct stat status;
+            if (fd < 0 || fstat(fd, &status) != 0)
+            {
+                std::cerr << "Unable to read file " << inputFile << std::endl;
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+                return;
+            }
+            auto fileSize = static_cast<std::size_t>(status.st_size);
+            size = fileSize + 2;
+            
+            // the part of the last page beyond the end of the file is filled with zeros
+            auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            if (fileSize % pageSize != 0 && fileSize % pageSize <= pageSize - 2)
+            {
+                auto address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                if (address != MAP_FAILED)
+                {
+                    data = static_cast<char*>(address);
+                    isMapped = true;
+                    madvise(address, size, MADV_SEQUENTIAL);
+                }
+            }
+            if (!isMapped)
+            {
+                copy.resize(size, '\0');
+                std::size_t bytesRead = 0;
+                while (bytesRead < fileSize)
+                {
+                    auto n = read(fd, copy.data() + bytesRead, fileSize - bytesRead);
+                    if (n <= 0)
+                    {
+                        std::cerr << "Unable to read file " << inputFile << std::endl;
+                        close(fd);
+                        return;
+                    }
+                    bytesRead += n;
+                }
+                data = copy.data();
+            }
+            close(fd);
+        }
+        
+        ~InputBuffer()
         {
-            std::cerr << "Unable to read file " << inputFile << std::endl;
-            exit(1);
+            if (isMapped)
+            {
+                munmap(data, size);
+            }
         }
         
-        yy_flex_debug = false;
+        InputBuffer(const InputBuffer&) = delete;
+        InputBuffer& operator=(const InputBuffer&) = delete;
         
-        // set parser input to inputFile
-        FILE* f = fopen(inputFile.c_str(), "r");
-        yy_buffer_state*bp = yy_create_buffer(f, YY_BUF_SIZE );
-        yy_create_buffer(f,YY_BUF_SIZE);
-        yy_switch_to_buffer(bp);
+        // nullptr if the file couldn't be read (which has been reported)
+        char* data = nullptr;
+        // including the null-bytes
+        std::size_t size = 0;
+        
+    private:
+        bool isMapped = false;
+        std::vector<char> copy;
+    };
+    
+    /*
+     * parses the input in the buffer data of the given size, which ends with two null-bytes.
+     * Internally calls the parser autogenerated by Flex and Bison.
+     * Returns std::nullopt if the input couldn't be parsed (the error has been reported).
+     */
+    std::optional<WhileParserResult> parseBuffer(const std::string& inputFile, char* data, std::size_t size)
+    {
+        // the scanner is reentrant: all its state is held by 'scanner' and the
+        // context, so several files can be parsed concurrently
+        yyscan_t scanner;
+        if (yylex_init(&scanner) != 0)
+        {
+            std::cerr << "Unable to initialize the scanner for " << inputFile << std::endl;
+            return std::nullopt;
+        }
+        yyset_debug(false, scanner);
+        
+        // scan the input in place. size includes the two null-bytes, which flex requires
+        // as end-of-buffer marker (otherwise yy_scan_buffer fails).
+        assert(size >= 2 && data[size - 2] == '\0' && data[size - 1] == '\0');
+        if (yy_scan_buffer(data, size, scanner) == nullptr)
+        {
+            yylex_destroy(scanner);
+            std::cerr << "Unable to scan the input of " << inputFile << std::endl;
+            return std::nullopt;
+        }
         
         // generate a context, whose fields are used as in/out-parameters for parsing
         parser::WhileParsingContext context;
         context.inputFile = inputFile;
         
         // parse the input-program into context
-        parser::WhileParser parser(context);
+        parser::WhileParser parser(context, scanner);
         parser.set_debug_level(false);
-        parser.parse();
-        fclose(f);
+        auto result = parser.parse();
+        
+        // frees the state of the scanner, but not the input
+        yylex_destroy(scanner);
         
-        // if there was an error during parsing, exit the program.
-        if (context.errorFlag)
+        // the error has already been reported by the parser
+        if (result != 0 || context.errorFlag)
         {
-            exit(1);
+            return std::nullopt;
         }
         
         assert(context.program);
         
         return WhileParserResult(std::move(context.program), std::move(context.locationToActiveVars), std::move(context.problemItems), context.numberOfTraces);
     }
+    
+    /*
+     * main method for parsing input. Returns std::nullopt if the file couldn't be read or
+     * parsed (the error has been reported).
+     */
+    std::optional<WhileParserResult> parse(std::string inputFile)
+    {
+        InputBuffer input(inputFile);
+        if (input.data == nullptr)
+        {
+            return std::nullopt;
+        }
+        return parseBuffer(inputFile, input.data, input.size);
+    }
+    
+    /*
+     * parses a spec given as text. inputFile is only used in error messages.
+     */
+    std::optional<WhileParserResult> parseText(std::string inputFile, std::string text)
+    {
+        text.append(2, '\0');
+        return parseBuffer(inputFile, &text[0], text.size());
+    }
 }
 
 #endif
@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "Formula.hpp"
+#include "Location.hpp"
 #include "Problem.hpp"
 #include "Program.hpp"
 #include "Signature.hpp"
@@ -28,6 +29,9 @@ namespace parser
         std::string inputFile;
         bool errorFlag;
         
+        // the location of the current token, maintained by the scanner
+        Location location;
+        
         // output
         std::unique_ptr<const program::Program> program;
         std::vector<std::shared_ptr<const logic::ProblemItem>> problemItems;
@@ -55,6 +59,7 @@ namespace parser
         void pushProgramVars();
         void popProgramVars();
         bool addProgramVar(std::shared_ptr<const program::Variable> programVar);
+        // returns nullptr if no program variable with the given name has been declared
         std::shared_ptr<const program::Variable> getProgramVar(std::string name);
         std::vector<std::shared_ptr<const program::Variable>> getActiveProgramVars();
         
@@ -1,6 +1,10 @@
 #include "Options.hpp"
 
+#include <algorithm>
+#include <cctype>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 #include <string>
 #include <utility>
 
@@ -18,6 +22,36 @@ bool BooleanOption::setValue(std::string v) {
   }
 }
 
+bool UnsignedOption::setValue(std::string v) {
+  if (v.empty() || !std::all_of(v.begin(), v.end(), ::isdigit)) {
+    return false;
+  }
+  try {
+    auto value = std::stoul(v);
+    if (value > std::numeric_limits<unsigned>::max()) {
+      return false;
+    }
+    _value = static_cast<unsigned>(value);
+    return true;
+  } catch (const std::out_of_range&) {
+    return false;
+  }
+}
+
+bool FloatOption::setValue(std::string v) {
+  try {
+    std::size_t length;
+    auto value = std::stod(v, &length);
+    if (length != v.size()) {
+      return false;
+    }
+    _value = value;
+    return true;
+  } catch (const std::logic_error&) {
+    return false;
+  }
+}
+
 bool MultiChoiceOption::setValue(std::string v) {
   for (auto it = _choices.begin(); it != _choices.end(); ++it) {
     if (*it == v) {
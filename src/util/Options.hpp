@@ -49,6 +49,32 @@ class StringOption : public Option {
   std::string _value;
 };
 
+class UnsignedOption : public Option {
+ public:
+  UnsignedOption(std::string name, unsigned defaultValue)
+      : Option(name), _value(defaultValue) {}
+
+  bool setValue(std::string v);
+
+  unsigned getValue() { return _value; }
+
+ protected:
+  unsigned _value;
+};
+
+class FloatOption : public Option {
+ public:
+  FloatOption(std::string name, double defaultValue)
+      : Option(name), _value(defaultValue) {}
+
+  bool setValue(std::string v);
+
+  double getValue() { return _value; }
+
+ protected:
+  double _value;
+};
+
 class MultiChoiceOption : public Option {
  public:
   MultiChoiceOption(std::string name, std::vector<std::string> choices,
@@ -73,12 +99,42 @@ class Configuration {
         _nativeNat("-nat", true),
         _inlineSemantics("-inlineSemantics", true),
         _lemmaPredicates("-lemmaPredicates", true),
+        _letBindings("-letBindings", false),
+        _normalize("-normalize", false),
+        _incremental("-incremental", false),
+        _pruneSignature("-pruneSignature", false),
+        _axiomSelection("-axiomSelection", {"all", "sine", "both"}, "all"),
+        _sineTolerance("-sineTolerance", 1.0),
+        _sineDepth("-sineDepth", 0),
+        _threads("-threads", 1),
+        _cacheDir("-cacheDir", ""),
+        _manifest("-manifest", false),
+        _archive("-archive", false),
+        _extract("-extract", ""),
+        _batch("-batch", false),
+        _jobs("-jobs", 1),
+        _serve("-serve", false),
         _allOptions() {
     registerOption(&_outputDir);
     registerOption(&_generateBenchmark);
     registerOption(&_nativeNat);
     registerOption(&_inlineSemantics);
     registerOption(&_lemmaPredicates);
+    registerOption(&_letBindings);
+    registerOption(&_normalize);
+    registerOption(&_incremental);
+    registerOption(&_pruneSignature);
+    registerOption(&_axiomSelection);
+    registerOption(&_sineTolerance);
+    registerOption(&_sineDepth);
+    registerOption(&_threads);
+    registerOption(&_cacheDir);
+    registerOption(&_manifest);
+    registerOption(&_archive);
+    registerOption(&_extract);
+    registerOption(&_batch);
+    registerOption(&_jobs);
+    registerOption(&_serve);
   }
 
   bool setAllValues(int argc, char* argv[]);
@@ -90,8 +146,25 @@ class Configuration {
   bool nativeNat() { return _nativeNat.getValue(); }
   bool inlineSemantics() { return _inlineSemantics.getValue(); }
   bool lemmaPredicates() { return _lemmaPredicates.getValue(); }
-
-  static Configuration instance() { return _instance; }
+  bool letBindings() { return _letBindings.getValue(); }
+  bool normalize() { return _normalize.getValue(); }
+  bool incremental() { return _incremental.getValue(); }
+  bool pruneSignature() { return _pruneSignature.getValue(); }
+  std::string axiomSelection() { return _axiomSelection.getValue(); }
+  double sineTolerance() { return _sineTolerance.getValue(); }
+  unsigned sineDepth() { return _sineDepth.getValue(); }
+  unsigned threads() { return _threads.getValue(); }
+  std::string cacheDir() { return _cacheDir.getValue(); }
+  bool manifest() { return _manifest.getValue(); }
+  bool archive() { return _archive.getValue(); }
+  std::string extract() { return _extract.getValue(); }
+  bool batch() { return _batch.getValue(); }
+  unsigned jobs() { return _jobs.getValue(); }
+  bool serve() { return _serve.getValue(); }
+
+  // options are only set once at startup, afterwards the configuration can be
+  // read concurrently
+  static Configuration& instance() { return _instance; }
 
  protected:
   StringOption _outputDir;
@@ -99,6 +172,43 @@ class Configuration {
   BooleanOption _nativeNat;
   BooleanOption _inlineSemantics;
   BooleanOption _lemmaPredicates;
+  // output repeated terms only once, using let
+  BooleanOption _letBindings;
+  // simplify all formulas before they are output
+  BooleanOption _normalize;
+  // output all tasks as a single incremental script using push/pop
+  BooleanOption _incremental;
+  // declare in each task only the sorts and symbols occurring in it
+  BooleanOption _pruneSignature;
+  // restrict the axioms of each task to the relevant ones (sine), or output
+  // both the restricted and the full task (both)
+  MultiChoiceOption _axiomSelection;
+  // an axiom is triggered by its symbols occurring in at most tolerance times
+  // as many axioms as its least common symbol
+  FloatOption _sineTolerance;
+  // the maximal number of selection rounds (0 means unlimited)
+  UnsignedOption _sineDepth;
+  // the number of threads writing tasks (0 means one per hardware thread)
+  UnsignedOption _threads;
+  // directory storing each generated task under the hash of its content, so
+  // that the tasks which are new since previous runs are known
+  StringOption _cacheDir;
+  // list the tasks and the lemmas they depend on in tasks.jsonl
+  BooleanOption _manifest;
+  // output all tasks into a single archive instead of one file per task
+  BooleanOption _archive;
+  // instead of generating tasks, output the task with the given name from the
+  // archive given as input file
+  StringOption _extract;
+  // the input file is a directory of specs or a file listing specs, which are
+  // all processed one after another
+  BooleanOption _batch;
+  // the number of specs processed concurrently in batch mode (0 means one per
+  // hardware thread)
+  UnsignedOption _jobs;
+  // instead of processing an input file, serve requests read from stdin, each
+  // processed like a separate call of rapid
+  BooleanOption _serve;
 
   std::map<std::string, Option*> _allOptions;
 
@@ -0,0 +1,305 @@
+#!/bin/sh
+# Runs rapid on the specs in this directory and checks properties of the
+# output. Prints each failed check and exits with 1 if any check failed.
+# usage: check.sh <rapid>
+
+rapid=$1
+dir=$(cd "$(dirname "$0")" && pwd)
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+failures=0
+
+fail() {
+  echo "FAIL: $1"
+  failures=$((failures + 1))
+}
+
+# let-bindings of terms over a quantified variable stay inside the quantifier
+mkdir "$tmp/let"
+"$rapid" -letBindings on -dir "$tmp/let/" \
+  "$dir/let-bindings-quantified-variables.spec" >/dev/null
+task="$tmp/let/user-conjecture-0.smt2"
+grep -q "(let ((_let" "$task" ||
+  fail "let-bindings-quantified-variables: no let-binding"
+awk '/^\(assert-not/ { c = 1 } c && /forall \(\(k Int\)\)/ { q = 1 }
+     c && !q && /\(let / { bad = 1 } END { exit bad }' "$task" ||
+  fail "let-bindings-quantified-variables: let-binding outside of forall"
+
+# with the let-bindings expanded, the output equals the one without them,
+# including the labels
+for spec in "$dir"/*.spec; do
+  name=$(basename "$spec" .spec)
+  for normalize in off on; do
+    mkdir "$tmp/plain" "$tmp/lets"
+    "$rapid" -normalize $normalize -dir "$tmp/plain/" "$spec" >/dev/null
+    "$rapid" -normalize $normalize -letBindings on -dir "$tmp/lets/" \
+      "$spec" >/dev/null
+    for task in "$tmp"/plain/*; do
+      awk -f "$dir/expand-lets.awk" "$tmp/lets/$(basename "$task")" |
+        cmp -s "$task" - ||
+        fail "$name: let-bindings change $(basename "$task")"
+    done
+    rm -r "$tmp/plain" "$tmp/lets"
+  done
+done
+
+# -normalize simplifies each conjecture to the expected formula. The
+# conjecture of a task is printed on a single line, with single spaces.
+mkdir "$tmp/normalize"
+"$rapid" -normalize on -dir "$tmp/normalize/" "$dir/normalize.spec" >/dev/null
+i=0
+while read -r expected; do
+  task="$tmp/normalize/user-conjecture-$i.smt2"
+  actual=$(sed -n '/^(assert-not/,/^)/p' "$task" | tr -s ' \t\n' ' ' |
+    sed 's/ )/)/g; s/ $//')
+  [ "$actual" = "(assert-not $expected)" ] ||
+    fail "normalize: conjecture $i normalized to $actual"
+  i=$((i + 1))
+done <<'EOF'
+(and (<= 0 alength) (< 0 alength))
+(<= 0 alength)
+(exists ((j Int)) (= (a (+ alength 1)) (a j)))
+(forall ((j Int)) (forall ((m Int)) (< (a j) (a m))))
+(forall ((k Int)) (=> (= k (+ k 1)) (< (a k) alength)))
+(and (< 5 alength) (< (* 999999999 999999999) alength))
+EOF
+
+# the incremental script checks each task (as output into a directory) in its
+# own push/pop-frame
+mkdir "$tmp/dir" "$tmp/incremental"
+"$rapid" -dir "$tmp/dir/" "$dir/init-array.spec" >/dev/null
+"$rapid" -incremental on -dir "$tmp/incremental/" "$dir/init-array.spec" \
+  >/dev/null
+script="$tmp/incremental/init-array.smt2"
+tasks=$(ls "$tmp/dir" | wc -l)
+[ "$(grep -c "^(check-sat)" "$script")" -eq "$tasks" ] ||
+  fail "init-array: incremental script doesn't check all $tasks tasks"
+awk '/^\(push/ { d++; if (d != 1) bad = 1 }
+     /^\(check-sat/ { if (d != 1) bad = 1 }
+     /^\(pop/ { d-- } END { exit bad || d != 0 }' "$script" ||
+  fail "init-array: incremental script has unbalanced push/pop-frames"
+
+# with -axiomSelection both, the incremental script checks each full task, and
+# the restricted one only if its frame differs
+mkdir "$tmp/incremental-both"
+"$rapid" -incremental on -axiomSelection both -dir "$tmp/incremental-both/" \
+  "$dir/init-array.spec" >/dev/null
+script="$tmp/incremental-both/init-array.smt2"
+[ "$(grep -c "^(check-sat)" "$script")" -ge "$tasks" ] ||
+  fail "init-array: incremental script with both doesn't check all tasks"
+awk '/^; (Lemma|Conjecture): / { name = $3; sub(/-sine$/, "", name) }
+     /^\(push/ { frame = "" } { frame = frame $0 "\n" }
+     /^\(pop/ { if (frame == frames[name]) bad = 1; frames[name] = frame }
+     END { exit bad }' "$script" ||
+  fail "init-array: incremental script with both checks a task twice"
+
+# -pruneSignature only drops declarations, and only of symbols which don't
+# occur in the task (outside of comments)
+mkdir "$tmp/pruned"
+"$rapid" -pruneSignature on -dir "$tmp/pruned/" "$dir/init-array.spec" \
+  >/dev/null
+for task in "$tmp"/dir/*; do
+  name=$(basename "$task")
+  awk 'FNR == NR {
+         if (/^\(declare/) full[$0] = 1; else fullRest = fullRest $0 "\n"
+         next
+       }
+       /^\(declare/ { if (!($0 in full)) bad = 1; pruned[$0] = 1; next }
+       { rest = rest $0 "\n" }
+       !/^ *;/ {
+         line = $0
+         gsub(/[()]/, " ", line)
+         n = split(line, tokens, " ")
+         for (i = 1; i <= n; i++) used[tokens[i]] = 1
+       }
+       END {
+         if (rest != fullRest) bad = 1
+         for (d in full) {
+           split(d, tokens, " ")
+           if (!(d in pruned) && tokens[2] in used) bad = 1
+         }
+         exit bad
+       }' "$task" "$tmp/pruned/$name" ||
+    fail "init-array: $name with pruned signature differs"
+done
+[ "$(grep -c "^(declare" "$tmp/pruned/user-conjecture-0.smt2")" -lt \
+  "$(grep -c "^(declare" "$tmp/dir/user-conjecture-0.smt2")" ] ||
+  fail "init-array: no declaration pruned"
+
+# SInE keeps the items a lemma is derived from (its fromItems), even if they
+# aren't reached from the symbols of the conjecture within the depth
+mkdir "$tmp/sine"
+"$rapid" -axiomSelection sine -sineDepth 1 -dir "$tmp/sine/" \
+  "$dir/init-array.spec" >/dev/null
+for task in "$tmp"/dir/value-evolution-*; do
+  name=$(basename "$task")
+  grep "^; \(Axiom\|Definition\):" "$task" >"$tmp/items"
+  grep "^; \(Axiom\|Definition\):" "$tmp/sine/$name" 2>/dev/null |
+    cmp -s "$tmp/items" - ||
+    fail "init-array: SInE drops items referenced by $name"
+done
+
+# SInE with depth 1 selects a proper subset of the items of the user conjecture,
+# and a higher tolerance selects a superset of them in every task
+mkdir "$tmp/sine-tolerance"
+"$rapid" -axiomSelection sine -sineDepth 1 -sineTolerance 10 \
+  -dir "$tmp/sine-tolerance/" "$dir/init-array.spec" >/dev/null
+for task in "$tmp"/dir/*; do
+  name=$(basename "$task")
+  grep "^; \(Axiom\|Definition\):" "$task" >"$tmp/items"
+  grep "^; \(Axiom\|Definition\):" "$tmp/sine/$name" >"$tmp/selected"
+  grep "^; \(Axiom\|Definition\):" "$tmp/sine-tolerance/$name" \
+    >"$tmp/tolerated"
+  ! grep -vxF -f "$tmp/items" "$tmp/selected" >/dev/null ||
+    fail "init-array: SInE selects items not in $name"
+  ! grep -vxF -f "$tmp/tolerated" "$tmp/selected" >/dev/null ||
+    fail "init-array: higher SInE tolerance drops items of $name"
+done
+task=user-conjecture-0.smt2
+selected=$(grep -c "^; \(Axiom\|Definition\):" "$tmp/sine/$task")
+[ "$selected" -lt "$(grep -c "^; \(Axiom\|Definition\):" "$tmp/dir/$task")" ] ||
+  fail "init-array: SInE with depth 1 drops no item of the user conjecture"
+[ "$selected" -lt \
+  "$(grep -c "^; \(Axiom\|Definition\):" "$tmp/sine-tolerance/$task")" ] ||
+  fail "init-array: higher SInE tolerance selects no further item"
+
+# extracting each task from an archive yields the task as output into a
+# directory
+mkdir "$tmp/archive"
+"$rapid" -archive on -dir "$tmp/archive/" "$dir/init-array.spec" >/dev/null
+for task in "$tmp"/dir/*; do
+  name=$(basename "$task")
+  "$rapid" -extract "$name" "$tmp/archive/init-array.tasks" |
+    cmp -s "$task" - ||
+    fail "init-array: extracting $name from the archive differs"
+done
+
+# an archive with a corrupt trailer is rejected, also if its index offset is
+# too large
+archive="$tmp/archive/init-array.tasks"
+size=$(wc -c <"$archive")
+for offset in 99999999999999999999 00000000000099999999 0000000000000000x000; do
+  { head -c $((size - 21)) "$archive"; echo "$offset"; } >"$tmp/corrupt.tasks"
+  "$rapid" -extract user-conjecture-0 "$tmp/corrupt.tasks" >/dev/null \
+    2>"$tmp/error"
+  [ $? -eq 1 ] && grep -q "is not a task archive" "$tmp/error" ||
+    fail "init-array: archive with index offset $offset not rejected"
+done
+
+# an existing archive is neither overwritten nor removed
+cp "$archive" "$tmp/archive.copy"
+"$rapid" -archive on -dir "$tmp/archive/" "$dir/init-array.spec" >/dev/null &&
+  fail "init-array: existing archive overwritten"
+cmp -s "$archive" "$tmp/archive.copy" ||
+  fail "init-array: existing archive changed"
+
+# the server reads an inline spec up to the line "." and continues with the
+# next request afterwards
+mkdir "$tmp/inline" "$tmp/served"
+{
+  echo "-dir $tmp/inline/ -"
+  cat "$dir/init-array.spec"
+  echo
+  echo "."
+  echo "-dir $tmp/served/ $dir/init-array.spec"
+} | "$rapid" -serve on >"$tmp/responses"
+[ "$(grep -c "^done$" "$tmp/responses")" -eq 2 ] ||
+  fail "init-array: server doesn't answer both requests with done"
+diff -r "$tmp/dir" "$tmp/inline" >/dev/null ||
+  fail "init-array: inline spec served differently"
+diff -r "$tmp/dir" "$tmp/served" >/dev/null ||
+  fail "init-array: spec served differently"
+
+# the server reads requests from a regular file exactly once, also if a
+# request sets options which differ from the ones of the server
+mkdir "$tmp/served1" "$tmp/served2" "$tmp/nat" "$tmp/served-nat"
+{
+  echo "-dir $tmp/served1/ $dir/init-array.spec"
+  echo "-nat off -dir $tmp/served-nat/ $dir/init-array.spec"
+  echo "-dir $tmp/served2/ $dir/init-array.spec"
+} >"$tmp/requests"
+timeout 30 "$rapid" -serve on <"$tmp/requests" >"$tmp/responses"
+[ "$(grep -c "^\(done\|failed\)$" "$tmp/responses")" -eq 3 ] &&
+  [ "$(grep -c "^done$" "$tmp/responses")" -eq 3 ] ||
+  fail "init-array: server doesn't answer each request from a file once"
+"$rapid" -nat off -dir "$tmp/nat/" "$dir/init-array.spec" >/dev/null
+diff -r "$tmp/dir" "$tmp/served1" >/dev/null &&
+  diff -r "$tmp/dir" "$tmp/served2" >/dev/null &&
+  diff -r "$tmp/nat" "$tmp/served-nat" >/dev/null ||
+  fail "init-array: requests from a file served differently"
+
+# in batch mode, a broken spec is reported and doesn't stop the other specs,
+# but rapid fails in the end
+mkdir "$tmp/specs" "$tmp/batch"
+cp "$dir/init-array.spec" "$tmp/specs/valid.spec"
+echo "func main() { Int x = 0; x = y; }" >"$tmp/specs/broken.spec"
+"$rapid" -batch on -jobs 2 -dir "$tmp/batch/" "$tmp/specs" >"$tmp/output"
+[ $? -ne 0 ] || fail "batch: broken spec doesn't fail"
+grep -q "^Error: Processing .*broken.spec failed" "$tmp/output" ||
+  fail "batch: broken spec not reported"
+diff -r "$tmp/dir" "$tmp"/batch/*valid >/dev/null ||
+  fail "batch: valid spec not output next to a broken one"
+
+# tasks.jsonl has one valid JSON line for each written task, which gives the
+# size of the task and the tasks of its dependencies
+mkdir "$tmp/manifest"
+"$rapid" -manifest on -threads 4 -dir "$tmp/manifest/" "$dir/init-array.spec" \
+  >/dev/null
+manifest="$tmp/manifest/tasks.jsonl"
+string='"([^"\\[:cntrl:]]|\\["\\/bfnrt]|\\u[0-9a-fA-F]{4})*"'
+grep -Evq "^\{\"task\":$string,\"type\":\"(lemma|conjecture)\",\
+\"dependencies\":\[($string(,$string)*)?\],\"axioms\":[0-9]+,\
+\"bytes\":[0-9]+,\"symbols\":[0-9]+\}$" "$manifest" &&
+  fail "init-array: tasks.jsonl has invalid lines"
+[ "$(wc -l <"$manifest")" -eq "$(ls "$tmp/manifest" | grep -c "\.smt2$")" ] &&
+  [ -z "$(sed 's/^{"task":"\([^"]*\)".*/\1/' "$manifest" | sort | uniq -d)" ] ||
+  fail "init-array: tasks.jsonl doesn't list each task once"
+while read -r line; do
+  name=$(echo "$line" | sed 's/^{"task":"\([^"]*\)".*/\1/')
+  bytes=$(echo "$line" | sed 's/.*"bytes":\([0-9]*\).*/\1/')
+  [ -f "$tmp/manifest/$name" ] &&
+    [ "$(wc -c <"$tmp/manifest/$name")" -eq "$bytes" ] ||
+    fail "init-array: tasks.jsonl lists $name with a wrong size"
+  for dependency in $(echo "$line" |
+    sed 's/.*"dependencies":\[\([^]]*\)\].*/\1/' | tr -d '"' | tr ',' ' '); do
+    [ -f "$tmp/manifest/$dependency" ] ||
+      fail "init-array: $name depends on missing task $dependency"
+  done
+done <"$manifest"
+
+# a second run reuses all cached tasks, and yields the same output. The cached
+# files are read-only, and one whose content differs isn't reused.
+mkdir "$tmp/cached1" "$tmp/cached2" "$tmp/cached3"
+for run in 1 2; do
+  "$rapid" -cacheDir "$tmp/cache" -dir "$tmp/cached$run/" \
+    "$dir/init-array.spec" >/dev/null
+  diff -r -x cache-manifest.txt "$tmp/dir" "$tmp/cached$run" >/dev/null ||
+    fail "init-array: output with cache differs in run $run"
+done
+[ "$(grep -c "^cached " "$tmp/cached2/cache-manifest.txt")" -eq "$tasks" ] ||
+  fail "init-array: second run doesn't reuse all cached tasks"
+[ -z "$(find "$tmp/cache" -type f \
+  \( -perm -u+w -o -perm -g+w -o -perm -o+w \))" ] ||
+  fail "init-array: cached files are writable"
+entry=$(sed -n '1s/^cached \([^ ]*\) .*/\1/p' "$tmp/cached2/cache-manifest.txt")
+chmod u+w "$tmp/cache/$entry.smt2"
+echo "(check-sat)" >"$tmp/cache/$entry.smt2"
+"$rapid" -cacheDir "$tmp/cache" -dir "$tmp/cached3/" "$dir/init-array.spec" \
+  >/dev/null
+grep -q "^new $entry-1 " "$tmp/cached3/cache-manifest.txt" &&
+  diff -r -x cache-manifest.txt "$tmp/dir" "$tmp/cached3" >/dev/null ||
+  fail "init-array: cached file with different content reused"
+
+# an error of a writing thread (here: the cache directory can't be created)
+# is reported, and stops the generation
+mkdir "$tmp/unwritable"
+touch "$tmp/file"
+"$rapid" -threads 4 -cacheDir "$tmp/file/cache" -dir "$tmp/unwritable/" \
+  "$dir/init-array.spec" >"$tmp/output" 2>&1
+[ $? -eq 1 ] && grep -q "^Error: Unable to output" "$tmp/output" ||
+  fail "init-array: error of a writing thread not reported"
+
+if [ $failures -ne 0 ]; then
+  exit 1
+fi
+echo "all checks passed"
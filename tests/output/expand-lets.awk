@@ -0,0 +1,53 @@
+# Expands the let-bindings in the output of rapid -letBindings on: removes each
+# let and the line closing it, and replaces each name by the term it binds.
+# The result equals the output without -letBindings.
+# usage: awk -f expand-lets.awk <task>
+
+# the names occurring in s replaced by their terms
+function expand(s,    result, name) {
+  result = ""
+  while (match(s, /_let[0-9]+/)) {
+    name = substr(s, RSTART, RLENGTH)
+    result = result substr(s, 1, RSTART - 1) value[name]
+    s = substr(s, RSTART + RLENGTH)
+  }
+  return result s
+}
+
+# a let binding a single name, written on its own line. It leaves one
+# parenthesis open, which is closed together with the other lets of the same
+# scope after the body.
+/^ *\(let \(\(_let[0-9]+ .*\)\)$/ {
+  line = $0
+  sub(/^ *\(let \(\(/, "", line)
+  name = substr(line, 1, index(line, " ") - 1)
+  value[name] = expand(substr(line, length(name) + 2,
+                              length(line) - length(name) - 3))
+  depth++
+  scopeDepth[++scopes] = depth
+  next
+}
+
+# the line closing the lets of the innermost scope, i.e. the first line of
+# closing parentheses after the body, which is balanced
+scopes && /^ *\)+$/ && depth == scopeDepth[scopes] {
+  closing = $0
+  gsub(/[^)]/, "", closing)
+  depth -= length(closing)
+  while (scopes && scopeDepth[scopes] > depth) {
+    scopes--
+  }
+  next
+}
+
+{
+  # labels are comments, which may contain parentheses
+  if ($0 !~ /^ *;/) {
+    opening = $0
+    closing = $0
+    gsub(/[^(]/, "", opening)
+    gsub(/[^)]/, "", closing)
+    depth += length(opening) - length(closing)
+  }
+  print expand($0)
+}
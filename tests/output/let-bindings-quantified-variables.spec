@@ -0,0 +1,21 @@
+// -letBindings on: the term over k occurring four times must be bound by a
+// let inside the quantifier binding k, not around the whole conjecture
+
+func main()
+{
+	const Int[] a;
+	const Int alength;
+	Int i = 0;
+}
+
+(conjecture
+	(forall ((k Int))
+		(=>
+			(and
+				(<= 0 (+ (+ (+ (+ k 1) 1) 1) 1))
+				(< (+ (+ (+ (+ k 1) 1) 1) 1) alength)
+			)
+			(= (a (+ (+ (+ (+ k 1) 1) 1) 1)) (a (+ (+ (+ (+ k 1) 1) 1) 1)))
+		)
+	)
+)
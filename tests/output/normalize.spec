@@ -0,0 +1,66 @@
+// -normalize on: each conjecture exercises one simplification, check.sh
+// compares the normalized conjectures with the expected ones
+
+func main()
+{
+	const Int[] a;
+	const Int alength;
+	Int i = 0;
+}
+
+// nested conjunctions are flattened, true and duplicates are removed
+(conjecture
+	(and
+		(and (<= 0 alength) (and true (< 0 alength)))
+		(< 0 alength)
+	)
+)
+
+// a disjunction containing a formula and its negation is true
+(conjecture
+	(and
+		(<= 0 alength)
+		(or (< 0 alength) (not (< 0 alength)))
+	)
+)
+
+// one-point rule, also substituting below the inner quantifier
+(conjecture
+	(forall ((k Int))
+		(=>
+			(= k (+ alength 1))
+			(exists ((j Int)) (= (a k) (a j)))
+		)
+	)
+)
+
+// one-point rule with a value over an enclosing quantified variable, which
+// is substituted into the scope of another quantifier
+(conjecture
+	(forall ((j Int))
+		(exists ((k Int))
+			(and
+				(= k j)
+				(forall ((m Int)) (< (a k) (a m)))
+			)
+		)
+	)
+)
+
+// no one-point rule if the value contains the variable itself
+(conjecture
+	(forall ((k Int))
+		(=>
+			(= k (+ k 1))
+			(< (a k) alength)
+		)
+	)
+)
+
+// ground arithmetic is folded unless the result overflows
+(conjecture
+	(and
+		(< (+ 2 3) alength)
+		(< (* 999999999 999999999) alength)
+	)
+)